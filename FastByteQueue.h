@@ -0,0 +1,206 @@
+//
+// Created by Anders Cedronius
+//
+
+// Usage
+
+// Single producer single consumer queue of variable size byte records.
+// The records are written back to back in a byte ring, no allocation per record.
+// auto queue = FastByteQueue<Size, L1-Cache size>
+// Size of the ring in bytes as a contiguous bitmask from LSB example 0xFFFF (64KB)
+// Optional memory ordering policy, same as FastQueue (FastQueueBarrierFence default)
+// The largest record is (Size + 1) / 2 - 8 bytes, see maxRecordSize()
+
+// Producer
+// uint8_t *data = queue.reserve(size); (nullptr if there is no room (or the queue is stopped), try again later)
+// write the record to data
+// queue.commit(); or queue.commit(usedSize) if less than size was used
+
+// Consumer
+// uint64_t size;
+// const uint8_t *data = queue.read(size); (nullptr if the queue is empty)
+// read the record
+// queue.release();
+// queue.isDrained() is true when the queue is stopped and all records are read
+
+// Call queue.stopQueue() from any thread to signal end of transaction
+
+// Every record starts with an 8 byte header holding the length of the record and is padded to 8 bytes.
+// A record never wraps. If the record does not fit before the end of the ring the rest of the ring is filled
+// with a padding record that the consumer skips, and the record is written at the start of the ring.
+
+#pragma once
+
+#include "FastQueue.h"
+#include <cstring>
+
+template<uint64_t RING_BUFFER_SIZE, uint64_t L1_CACHE_LNE, typename BARRIER = FastQueueBarrierFence>
+class FastByteQueue {
+public:
+    explicit FastByteQueue() = default;
+
+    static constexpr uint64_t maxRecordSize() {
+        return (RING_BUFFER_SIZE + 1) / 2 - sizeof(RecordHeader);
+    }
+
+    ///////////////////////
+    /// Push part
+    ///////////////////////
+
+    //Reserve aSize bytes. Returns nullptr if there is no room in the ring or the queue is stopped.
+    uint8_t *reserve(uint64_t aSize) noexcept {
+        if (aSize > maxRecordSize() || mExitThreadSemaphore) {
+            return nullptr;
+        }
+        uint64_t lRecord = recordSize(aSize);
+        uint64_t lOffset = mWritePositionPush & RING_BUFFER_SIZE;
+        uint64_t lToEnd = RING_BUFFER_SIZE + 1 - lOffset;
+        uint64_t lPadding = lRecord > lToEnd ? lToEnd : 0;
+        if (!hasRoom(lPadding + lRecord)) {
+            return nullptr;
+        }
+        if (lPadding) {
+            //Published together with the record by commit()
+            auto lpPadding = (RecordHeader *) &mRingBuffer[lOffset];
+            lpPadding->mLength = lPadding - sizeof(RecordHeader);
+            lpPadding->mType = RECORD_PADDING;
+            lOffset = 0;
+        }
+        mReservedPadding = lPadding;
+        mReservedSize = aSize;
+        return &mRingBuffer[lOffset + sizeof(RecordHeader)];
+    }
+
+    //Publish the reserved record
+    void commit() noexcept {
+        commit(mReservedSize);
+    }
+
+    //Publish the reserved record using aSize bytes (aSize <= the reserved size)
+    void commit(uint64_t aSize) noexcept {
+        uint64_t lOffset = (mWritePositionPush + mReservedPadding) & RING_BUFFER_SIZE;
+        auto lpHeader = (RecordHeader *) &mRingBuffer[lOffset];
+        lpHeader->mLength = (uint32_t) aSize;
+        lpHeader->mType = RECORD_DATA;
+        BARRIER::releasePush();
+        mWritePositionPush += mReservedPadding + recordSize(aSize);
+        mWritePositionPop = mWritePositionPush;
+    }
+
+    //Copy aSize bytes from pData to the queue. Returns false if there is no room or the queue is stopped.
+    bool tryPush(const void *pData, uint64_t aSize) noexcept {
+        uint8_t *lpRecord = reserve(aSize);
+        if (!lpRecord) {
+            return false;
+        }
+        std::memcpy(lpRecord, pData, aSize);
+        commit();
+        return true;
+    }
+
+    ///////////////////////
+    /// Pop part
+    ///////////////////////
+
+    //Returns a pointer to the next record and its size in rSize, nullptr if the queue is empty.
+    //The record stays valid until release() is called.
+    const uint8_t *read(uint64_t &rSize) noexcept {
+        while (true) {
+            if (isEmpty()) {
+                return nullptr;
+            }
+            auto lpHeader = (const RecordHeader *) &mRingBuffer[mReadPositionPop & RING_BUFFER_SIZE];
+            if (lpHeader->mType == RECORD_PADDING) {
+                //The record that follows was committed together with the padding
+                mReadPositionPop += sizeof(RecordHeader) + lpHeader->mLength;
+                continue;
+            }
+            rSize = lpHeader->mLength;
+            return (const uint8_t *) lpHeader + sizeof(RecordHeader);
+        }
+    }
+
+    //Hand the record returned by read() back to the producer
+    void release() noexcept {
+        auto lpHeader = (const RecordHeader *) &mRingBuffer[mReadPositionPop & RING_BUFFER_SIZE];
+        uint64_t lRecord = recordSize(lpHeader->mLength);
+        BARRIER::releasePop();
+        mReadPositionPop += lRecord;
+        mReadPositionPush = mReadPositionPop;
+    }
+
+    //Stop queue (Maybe called from any thread)
+    void stopQueue() {
+        mExitThread = mWritePositionPush;
+        mExitThreadSemaphore = true;
+    }
+
+    //Is the queue stopped?
+    bool isQueueStopped() {
+        return mExitThreadSemaphore;
+    }
+
+    //True when the queue is stopped and all records are read (consumer side)
+    bool isDrained() {
+        uint64_t lSize;
+        return !read(lSize) && mExitThreadSemaphore && mExitThread == mReadPositionPop;
+    }
+
+    ///Delete copy and move constructors and assign operators
+    FastByteQueue(FastByteQueue const &) = delete;              // Copy construct
+    FastByteQueue(FastByteQueue &&) = delete;                   // Move construct
+    FastByteQueue &operator=(FastByteQueue const &) = delete;   // Copy assign
+    FastByteQueue &operator=(FastByteQueue &&) = delete;        // Move assign
+private:
+    static_assert(RING_BUFFER_SIZE && !(RING_BUFFER_SIZE & (RING_BUFFER_SIZE + 1)),
+                  "Buffer size must be a number of contiguous bits set from LSB. Example: 0xFFFF");
+    static_assert(RING_BUFFER_SIZE >= 63, "The byte ring must be at least 64 bytes");
+
+    enum RecordType : uint32_t {
+        RECORD_DATA,
+        RECORD_PADDING
+    };
+
+    struct RecordHeader {
+        uint32_t mLength;
+        uint32_t mType;
+    };
+
+    static constexpr uint64_t recordSize(uint64_t aSize) {
+        return (sizeof(RecordHeader) + aSize + 7) & ~7ULL;
+    }
+
+    //Room for aBytes as seen by the producer. The consumer position is only fetched when the cached
+    //copy says there is no room.
+    inline bool hasRoom(uint64_t aBytes) {
+        if (RING_BUFFER_SIZE + 1 - (mWritePositionPush - mReadPositionCache) >= aBytes) {
+            return true;
+        }
+        mReadPositionCache = mReadPositionPush;
+        BARRIER::acquire();
+        return RING_BUFFER_SIZE + 1 - (mWritePositionPush - mReadPositionCache) >= aBytes;
+    }
+
+    inline bool isEmpty() {
+        if (mReadPositionPop != mWritePositionCache) {
+            return false;
+        }
+        mWritePositionCache = mWritePositionPop;
+        BARRIER::acquire();
+        return mReadPositionPop == mWritePositionCache;
+    }
+
+    alignas(L1_CACHE_LNE) volatile uint8_t mBorderUpp[L1_CACHE_LNE];
+    alignas(L1_CACHE_LNE) volatile uint64_t mWritePositionPush = 0;
+    uint64_t mReadPositionCache = 0; //Producer local copy of mReadPositionPush
+    uint64_t mReservedPadding = 0;
+    uint64_t mReservedSize = 0;
+    alignas(L1_CACHE_LNE) volatile uint64_t mReadPositionPop = 0;
+    uint64_t mWritePositionCache = 0; //Consumer local copy of mWritePositionPop
+    alignas(L1_CACHE_LNE) volatile uint64_t mWritePositionPop = 0;
+    alignas(L1_CACHE_LNE) volatile uint64_t mReadPositionPush = 0;
+    alignas(L1_CACHE_LNE) volatile uint64_t mExitThread = 0;
+    alignas(L1_CACHE_LNE) volatile bool mExitThreadSemaphore = false;
+    alignas(L1_CACHE_LNE) uint8_t mRingBuffer[RING_BUFFER_SIZE + 1];
+    alignas(L1_CACHE_LNE) volatile uint8_t mBorderDown[L1_CACHE_LNE];
+};
@@ -0,0 +1,130 @@
+//
+// Created by Anders Cedronius
+//
+
+// Lock-free producer (one thread) and consumer (another thread) integrity test of the FastByteQueue
+// The producer writes records of random size (1 - maxRecordSize() bytes) at an irregular rate in time
+// containing random data, a simple checksum and a counter.
+// The consumer reads the records at an equally irregular rate verifying the size, the checksum and linearity
+// of the counter. The ring is set small (4KB) to make the test face full/empty and wrap situations as often
+// as possible.
+
+#include <random>
+#include <iostream>
+#include <thread>
+#include <numeric>
+#include "PinToCPU.h"
+#include "FastByteQueue.h"
+
+#define QUEUE_BYTES 0xFFF
+#define L1_CACHE_LINE 64
+#define TEST_TIME_DURATION_SEC 200
+
+using ByteQueue = FastByteQueue<QUEUE_BYTES, L1_CACHE_LINE>;
+
+//Counter, size and checksum
+#define RECORD_HEADER_SIZE 24
+
+bool gActiveProducer = true;
+std::atomic<uint64_t> gActiveConsumer = 0;
+bool gStartBench = false;
+std::atomic<uint64_t> gTransactions = 0;
+
+void producer(ByteQueue *rQueue, int32_t aCPU) {
+    std::random_device lRndDevice;
+    std::mt19937 lMersenneEngine{lRndDevice()};
+    std::uniform_int_distribution<int> lDist{1, 500};
+    std::uniform_int_distribution<uint64_t> lSizeDist{RECORD_HEADER_SIZE, ByteQueue::maxRecordSize()};
+    if (!pinThread(aCPU)) {
+        std::cout << "Pin CPU fail. " << std::endl;
+        rQueue->stopQueue();
+        return;
+    }
+    while (!gStartBench) {
+#ifdef _MSC_VER
+        __nop();
+#else
+        asm("NOP");
+#endif
+    }
+    uint64_t lCounter = 0;
+    while (gActiveProducer) {
+        uint64_t lSize = lSizeDist(lMersenneEngine);
+        uint8_t *lpData = rQueue->reserve(lSize);
+        if (!lpData) {
+            continue;
+        }
+        for (uint64_t i = RECORD_HEADER_SIZE; i < lSize; i++) {
+            lpData[i] = (uint8_t) lDist(lMersenneEngine);
+        }
+        *(uint64_t *) lpData = lCounter++;
+        *(uint64_t *) (lpData + 8) = lSize;
+        *(uint64_t *) (lpData + 16) = std::accumulate(lpData + RECORD_HEADER_SIZE, lpData + lSize, (uint64_t) 0);
+        rQueue->commit();
+        uint64_t lSleep = lDist(lMersenneEngine);
+        std::this_thread::sleep_for(std::chrono::nanoseconds(lSleep));
+    }
+    rQueue->stopQueue();
+}
+
+void consumer(ByteQueue *rQueue, int32_t aCPU) {
+    uint64_t lCounter = 0;
+    std::random_device lRndDevice;
+    std::mt19937 lMersenneEngine{lRndDevice()};
+    std::uniform_int_distribution<int> lDist{1, 500};
+    if (!pinThread(aCPU)) {
+        std::cout << "Pin CPU fail. " << std::endl;
+        gActiveConsumer--;
+        return;
+    }
+    gActiveConsumer++;
+    while (true) {
+        uint64_t lSize = 0;
+        const uint8_t *lpData = rQueue->read(lSize);
+        if (!lpData) {
+            if (rQueue->isDrained()) {
+                break;
+            }
+            continue;
+        }
+        if (lCounter != *(uint64_t *) lpData) {
+            std::cout << "Test failed.. Not linear data. " << *(uint64_t *) lpData << std::endl;
+            gActiveConsumer--;
+            return;
+        }
+        if (lSize != *(uint64_t *) (lpData + 8)) {
+            std::cout << "Test failed.. Wrong size. " << lSize << " " << lCounter << std::endl;
+            gActiveConsumer--;
+            return;
+        }
+        uint64_t lSimpleSum = std::accumulate(lpData + RECORD_HEADER_SIZE, lpData + lSize, (uint64_t) 0);
+        if (lSimpleSum != *(uint64_t *) (lpData + 16)) {
+            std::cout << "Test failed.. Not consistent data. " << lSimpleSum << " " << lCounter << std::endl;
+            gActiveConsumer--;
+            return;
+        }
+        rQueue->release();
+        lCounter++;
+        uint64_t lSleep = lDist(lMersenneEngine);
+        std::this_thread::sleep_for(std::chrono::nanoseconds(lSleep));
+    }
+    gTransactions = lCounter;
+    gActiveConsumer--;
+}
+
+int main() {
+    auto lQueue1 = new ByteQueue();
+    std::thread([lQueue1] { return consumer(lQueue1, 0); }).detach();
+    std::thread([lQueue1] { return producer(lQueue1, 2); }).detach();
+    std::cout << "Producer -> Consumer (start)" << std::endl;
+    gStartBench = true;
+    std::this_thread::sleep_for(std::chrono::seconds(TEST_TIME_DURATION_SEC));
+    gActiveProducer = false;
+    std::cout << "Producer -> Consumer (end)" << std::endl;
+    while (gActiveConsumer) {
+        std::this_thread::sleep_for(std::chrono::milliseconds(1));
+    }
+    delete lQueue1;
+    std::cout << "Test ended. Did " << gTransactions << " transactions." << std::endl;
+    return EXIT_SUCCESS;
+}
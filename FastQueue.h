@@ -11,6 +11,29 @@
 // The ring buffer is acting as a rubber band between the
 // producer/consumer to avoid unnecessary stalls when pushing new data.
 // L1-Cache size typically 64 bytes
+// Optional layout of the ring buffer
+// FastQueueLayout::PADDED (default) every item is placed on its own cache line
+// FastQueueLayout::DENSE the items are packed L1-Cache size / sizeof(Type) per cache line
+// auto queue = FastQueue<Type, Size, L1-Cache size, FastQueueLayout::DENSE>
+// Size 0 creates a queue sized at runtime, the ring buffer is then allocated by the constructor
+// auto queue = FastQueue<Type, 0, L1-Cache size>(Size, FastQueueMemory::HUGE_PAGES)
+// FastQueueNuma places the ring (constructor) and the producer and consumer lines (fastQueueNewOnNodes) on NUMA nodes
+// FastQueueNuma numa = {ringNode, producerNode, consumerNode};
+// auto queue = fastQueueNewOnNodes<FastQueue<Type, 0, L1-Cache size>>(numa, Size)
+// Optional wait strategy used while push is spinning on a full queue and pop on an empty queue
+// FastQueueWaitBusy (default), FastQueueWaitPause, FastQueueWaitBackoff<>, FastQueueWaitSleep<> or
+// FastQueueWaitFutex<> (Linux, idle threads sleep in the kernel and are woken by the other side) or
+// FastQueueWaitMonitor<> (UMWAIT / wfe, idle threads wait in hardware until the other side writes)
+// Optional memory ordering policy
+// FastQueueBarrierFence (default, sfence/lfence or dmb), FastQueueBarrierAtomic (std::atomic fences) or
+// FastQueueBarrierMinimal (compiler barrier only on x86_64)
+// auto queue = FastQueue<Type, Size, L1-Cache size, FastQueueLayout::PADDED, FastQueueWaitPause>
+// Optional instrumentation policy
+// FastQueueNoStats (default, nothing), FastQueueStats (push/pop totals, full/empty spins, max occupancy and
+// an occupancy histogram, see producerStats() and consumerStats()) or FastQueueLatencyStats<> (sampled time in
+// queue histogram, see consumerStats().percentileNs())
+// Optional FastQueuePositions::UNCACHED reads the other sides position on every full/empty check instead of
+// keeping a private copy (CACHED, default). Only meant as a benchmark reference.
 
 // queue.push is blocking if queue is full
 // queue.stopQueue() or a popped entry will release the spinlock only.
@@ -22,6 +45,14 @@
 // if result is {} this signals all objects are popped and the consumer should
 // not pop any more data
 
+// queue.pushBulk(first, last) / queue.popBulk(out, maxCount) are non-blocking and move
+// as many items as possible using one fence and one index update for the whole batch.
+// They return the number of items transferred.
+
+// queue.reservePush() / queue.commitPush() and queue.peek() / queue.release() lets the producer
+// build and the consumer read the item in place in the ring buffer without moving it.
+// reservePush() returns nullptr if full and peek() returns nullptr if empty.
+
 // use tryPush and/or tryPop if you want to avoid spinlock CPU hogging for low
 // frequency data transfer tryPush should be followed by pushAfterTry if used
 // and tryPop should be followed by popAfterTry.
@@ -37,15 +68,24 @@
 
 #include <iostream>
 #include <cstdint>
+#include <cstddef>
+#include <cmath>
 #include <vector>
 #include <atomic>
 #include <stdexcept>
 #include <bitset>
+#include <type_traits>
+#include <new>
+#include <thread>
+#include <chrono>
 
 #if __x86_64__ || _M_X64
 #include <immintrin.h>
 #ifdef _MSC_VER
 #include <intrin.h>
+#else
+#include <cpuid.h>
+#include <x86intrin.h>
 #endif
 #elif __aarch64__ || _M_ARM64
 #ifdef _MSC_VER
@@ -55,50 +95,307 @@
 #error Arhitecture not supported
 #endif
 
-template<typename T, uint64_t RING_BUFFER_SIZE, uint64_t L1_CACHE_LNE>
-class FastQueue {
-public:
+#if defined(__linux__) || defined(__APPLE__)
+#include <sys/mman.h>
+#include <unistd.h>
+#endif
+#if defined(__linux__)
+#include <sys/syscall.h>
+#include <linux/futex.h>
+#include <ctime>
+#endif
+#if defined(_MSC_VER)
+#include <malloc.h>
+#endif
 
-    enum class FastQueueMessages : uint64_t {
-        END_OF_SERVICE,
-        READY_TO_POP,
-        NOT_READY_TO_POP,
-        READY_TO_PUSH,
-        NOT_READY_TO_PUSH,
-    };
+//PADDED places every item on its own cache line. The producer and consumer never share a cache
+//line for the data but every item costs a full cache line of memory.
+//DENSE packs the items back to back. Consecutive pops are served from the same cache line and the
+//hardware prefetcher can stream the ring, at the cost of the producer and consumer sharing the cache
+//line holding the item they are working on when the queue is close to empty.
+enum class FastQueueLayout : uint64_t {
+    PADDED,
+    DENSE
+};
 
-    explicit FastQueue() {
-        uint64_t lSource = RING_BUFFER_SIZE;
-        uint64_t lContiguousBits = 0;
-        while (true) {
-            if (!(lSource & 1)) break;
-            lSource = lSource >> 1;
-            lContiguousBits++;
+//One ring buffer slot, shared by FastQueue, FastQueueBroadcast and FastQueueStealRing. DENSE is the item as is.
+template<typename T, uint64_t L1_CACHE_LNE, FastQueueLayout LAYOUT = FastQueueLayout::PADDED>
+struct FastQueueSlot {
+    T mObj;
+};
+
+//PADDED fills the slot up to a cache line
+template<typename T, uint64_t L1_CACHE_LNE>
+struct alignas(L1_CACHE_LNE) FastQueueSlot<T, L1_CACHE_LNE, FastQueueLayout::PADDED> {
+    T mObj;
+    volatile uint8_t mStuff[L1_CACHE_LNE - sizeof(T)];
+};
+
+//Throws unless the ring buffer mask is a number of contiguous bits set from LSB
+inline void fastQueueVerifyBufferMask(uint64_t aMask) {
+    uint64_t lSource = aMask;
+    uint64_t lContiguousBits = 0;
+    while (true) {
+        if (!(lSource & 1)) break;
+        lSource = lSource >> 1;
+        lContiguousBits++;
+    }
+
+    uint64_t lBitsSetTotal = std::bitset<64>(aMask).count();
+    if (lContiguousBits != lBitsSetTotal || !lContiguousBits) {
+        throw std::runtime_error(
+                "Buffer size must be a number of contiguous bits set from LSB. Example: 0b00001111 not 0b01001111");
+    }
+}
+
+//How the producer and consumer learn the position of the other side.
+//CACHED (default) keeps a private copy and only reads the other sides cache line when the copy says full/empty.
+//UNCACHED reads the other sides cache line on every full/empty check. Only there as a reference to measure
+//what the cached copy buys.
+enum class FastQueuePositions : uint64_t {
+    CACHED,
+    UNCACHED
+};
+
+//Memory backing the ring buffer of a runtime sized queue.
+//HUGE_PAGES tries MAP_HUGETLB and falls back to transparent huge pages (madvise) on Linux.
+//Other platforms use normal pages.
+enum class FastQueueMemory : uint64_t {
+    DEFAULT,
+    HUGE_PAGES
+};
+
+#define FASTQUEUE_HUGE_PAGE_SIZE (2ULL * 1024 * 1024)
+
+//NUMA nodes for a runtime sized queue, -1 leaves the memory to the default policy (the node of the thread
+//touching it first). The ring is bound by the constructor, the producer and consumer lines by fastQueueNewOnNodes().
+//Linux only, ignored on other platforms. The node of a CPU is found with cpuNumaNode() in PinToCPU.h.
+struct FastQueueNuma {
+    int32_t mRingNode = -1;
+    int32_t mProducerNode = -1;
+    int32_t mConsumerNode = -1;
+};
+
+inline uint64_t fastQueuePageSize() {
+#if defined(__linux__) || defined(__APPLE__)
+    return (uint64_t) sysconf(_SC_PAGESIZE);
+#else
+    return 4096;
+#endif
+}
+
+//Bind the pages of pMemory (page aligned and not yet touched) to aNode. Returns false if the kernel refused.
+inline bool fastQueueBindNode(void *pMemory, uint64_t aBytes, int32_t aNode) {
+    if (aNode < 0) {
+        return true;
+    }
+#if defined(__linux__)
+    //MPOL_BIND, no libnuma needed for one call
+    const unsigned long lBind = 2;
+    const unsigned long lBits = 8 * sizeof(unsigned long);
+    std::vector<unsigned long> lNodeMask(aNode / lBits + 1, 0);
+    lNodeMask[aNode / lBits] = 1UL << (aNode % lBits);
+    return !syscall(__NR_mbind, pMemory, aBytes, lBind, lNodeMask.data(), lNodeMask.size() * lBits + 1, 0);
+#else
+    return true;
+#endif
+}
+
+//Tell the CPU we are in a spin loop. Frees execution resources for the SMT sibling and
+//avoids the memory order violation penalty when leaving the loop.
+inline void fastQueueCpuRelax() {
+#if __x86_64__ || _M_X64
+    _mm_pause();
+#elif __aarch64__ || _M_ARM64
+#ifdef _MSC_VER
+    __yield();
+#else
+    asm volatile("yield" : : : "memory");
+#endif
+#else
+#error Architecture not supported
+#endif
+}
+
+//Wait strategies used by push() when the queue is full and by pop() when the queue is empty.
+//wait() is called once every time the queue is found full/empty.
+//rWatched is the position written by the other side that we are waiting on to change,
+//aLastSeen is the value we last read from it and aSpins is the number of times wait() has been
+//called before in the same spin loop.
+//notify() is called after a position the other side may wait on has been updated and when the
+//queue is stopped.
+
+//Spin as fast as possible. Lowest latency, burns the core and starves the SMT sibling.
+struct FastQueueWaitBusy {
+    inline void wait(const volatile uint64_t &, uint64_t, uint64_t) {}
+    inline void notify(const volatile uint64_t &) {}
+};
+
+//Spin with a pause (x86) / yield (arm64) instruction in the loop.
+struct FastQueueWaitPause {
+    inline void wait(const volatile uint64_t &, uint64_t, uint64_t) {
+        fastQueueCpuRelax();
+    }
+
+    inline void notify(const volatile uint64_t &) {}
+};
+
+//Spin with an exponentially growing number of pause instructions. After PAUSE_ROUNDS rounds
+//the thread yields to the OS scheduler (sched_yield) for every wait.
+template<uint64_t PAUSE_ROUNDS = 10>
+struct FastQueueWaitBackoff {
+    inline void wait(const volatile uint64_t &, uint64_t, uint64_t aSpins) {
+        if (aSpins < PAUSE_ROUNDS) {
+            for (uint64_t i = 0; i < (1ULL << aSpins); i++) {
+                fastQueueCpuRelax();
+            }
+            return;
         }
+        std::this_thread::yield();
+    }
 
-        uint64_t lBitsSetTotal = std::bitset<64>(RING_BUFFER_SIZE).count();
-        if (lContiguousBits != lBitsSetTotal || !lContiguousBits) {
-            throw std::runtime_error(
-                    "Buffer size must be a number of contiguous bits set from LSB. Example: 0b00001111 not 0b01001111");
+    inline void notify(const volatile uint64_t &) {}
+};
+
+//Spin SPIN_COUNT times then sleep SLEEP_US microseconds for every wait.
+//For queues sharing the core with other work where latency is less important.
+template<uint64_t SPIN_COUNT = 1000, uint64_t SLEEP_US = 50>
+struct FastQueueWaitSleep {
+    inline void wait(const volatile uint64_t &, uint64_t, uint64_t aSpins) {
+        if (aSpins < SPIN_COUNT) {
+            fastQueueCpuRelax();
+            return;
         }
-        if ((uint64_t) &mWritePositionPush % 8 || (uint64_t) &mReadPositionPop % 8) {
-            throw std::runtime_error("Queue-pointers are misaligned in memory.");
+        std::this_thread::sleep_for(std::chrono::microseconds(SLEEP_US));
+    }
+
+    inline void notify(const volatile uint64_t &) {}
+};
+
+//Blocking wait (Linux). Spin SPIN_COUNT times, then announce that we are sleeping and sleep on a futex
+//on the position we wait for. The other side only makes the wake-up syscall if someone announced
+//sleeping, so there are no syscalls as long as the queue is kept busy. The price is a full memory
+//barrier for every push/pop to order the position update against reading the sleeper count.
+//The sleep is bounded by TIMEOUT_US as a stopQueue() racing with a thread going to sleep is not
+//guaranteed to wake it. The futex is process shared so the queue may live in shared memory.
+//Other platforms sleep 50us at a time after SPIN_COUNT spins.
+template<uint64_t SPIN_COUNT = 1000, uint64_t TIMEOUT_US = 100000>
+struct FastQueueWaitFutex {
+    inline void wait(const volatile uint64_t &rWatched, uint64_t aLastSeen, uint64_t aSpins) {
+        if (aSpins < SPIN_COUNT) {
+            fastQueueCpuRelax();
+            return;
         }
+#if defined(__linux__)
+        mSleepers.fetch_add(1, std::memory_order_seq_cst);
+        std::atomic_thread_fence(std::memory_order_seq_cst);
+        struct timespec lTimeout = {(time_t) (TIMEOUT_US / 1000000), (long) ((TIMEOUT_US % 1000000) * 1000)};
+        //The kernel only puts us to sleep if the low 32 bits of the position are still what we saw
+        syscall(SYS_futex, (const volatile uint32_t *) &rWatched, FUTEX_WAIT, (uint32_t) aLastSeen, &lTimeout,
+                nullptr, 0);
+        mSleepers.fetch_sub(1, std::memory_order_relaxed);
+#else
+        std::this_thread::sleep_for(std::chrono::microseconds(50));
+#endif
     }
 
-    ///////////////////////
-    /// Push part
-    ///////////////////////
+    inline void notify(const volatile uint64_t &rWatched) {
+#if defined(__linux__)
+        std::atomic_thread_fence(std::memory_order_seq_cst);
+        if (mSleepers.load(std::memory_order_relaxed)) {
+            syscall(SYS_futex, (const volatile uint32_t *) &rWatched, FUTEX_WAKE, INT32_MAX, nullptr, nullptr, 0);
+        }
+#endif
+    }
 
-    FastQueueMessages tryPush() {
-        if (mWritePositionPush - mReadPositionPush >= RING_BUFFER_SIZE || mExitThreadSemaphore) {
-            return FastQueueMessages::NOT_READY_TO_PUSH;
+    std::atomic<uint32_t> mSleepers = {0};
+};
+
+//Does the CPU have WAITPKG (UMONITOR / UMWAIT / TPAUSE), CPUID leaf 7 ECX bit 5
+inline bool fastQueueHasWaitPkg() {
+#if __x86_64__ || _M_X64
+#ifdef _MSC_VER
+    int lRegisters[4];
+    __cpuidex(lRegisters, 7, 0);
+    return lRegisters[2] & (1 << 5);
+#else
+    unsigned int lEax, lEbx, lEcx, lEdx;
+    if (!__get_cpuid_count(7, 0, &lEax, &lEbx, &lEcx, &lEdx)) {
+        return false;
+    }
+    return lEcx & (1 << 5);
+#endif
+#else
+    return false;
+#endif
+}
+
+//Spin SPIN_COUNT times then let the hardware wait for the position we wait on to be written.
+//x86 with WAITPKG arms UMONITOR on the position line and waits in UMWAIT (C0.1, the fast wake-up state)
+//for at most TIMEOUT_CYCLES TSC cycles. arm64 arms the exclusive monitor on the line (ldxr) and waits in wfe.
+//The store of the other side wakes the core, no syscalls and no notify() needed. The core stays idle
+//instead of polling the line and leaves the execution resources to the SMT sibling.
+//stopQueue() does not write the watched line so it is seen when the wait times out, at most TIMEOUT_CYCLES
+//on x86 (the OS may cap it, IA32_UMWAIT_CONTROL) and at the next event stream tick on arm64 (100us on Linux).
+//x86 without WAITPKG and MSVC arm64 fall back to pause / yield.
+template<uint64_t SPIN_COUNT = 0, uint64_t TIMEOUT_CYCLES = 100000>
+struct FastQueueWaitMonitor {
+    inline void wait(const volatile uint64_t &rWatched, uint64_t aLastSeen, uint64_t aSpins) {
+        if (aSpins < SPIN_COUNT) {
+            fastQueueCpuRelax();
+            return;
         }
-        return FastQueueMessages::READY_TO_PUSH;
+#if __x86_64__ || _M_X64
+        if (!mHasWaitPkg) {
+            fastQueueCpuRelax();
+            return;
+        }
+        uint64_t lDeadline = __rdtsc() + TIMEOUT_CYCLES;
+#ifdef _MSC_VER
+        _umonitor((void *) &rWatched);
+        if (rWatched == aLastSeen) {
+            _umwait(1, lDeadline);
+        }
+#else
+        asm volatile("umonitor %0" : : "r"(&rWatched) : "memory");
+        //Written after we last looked but before the monitor was armed, no wake-up is coming for that one
+        if (rWatched == aLastSeen) {
+            asm volatile("umwait %0" : : "r"(1), "a"((uint32_t) lDeadline), "d"((uint32_t) (lDeadline >> 32))
+                    : "memory", "cc");
+        }
+#endif
+#elif __aarch64__ || _M_ARM64
+#ifdef _MSC_VER
+        fastQueueCpuRelax();
+#else
+        uint64_t lValue;
+        asm volatile("ldxr %0, [%1]" : "=r"(lValue) : "r"(&rWatched) : "memory");
+        //A pending event (or an earlier store) makes wfe return at once, the caller checks again
+        if (lValue == aLastSeen) {
+            asm volatile("wfe" : : : "memory");
+        }
+#endif
+#else
+#error Architecture not supported
+#endif
     }
 
-    void pushAfterTry(T &rItem) {
-        mRingBuffer[mWritePositionPush & RING_BUFFER_SIZE].mObj = std::move(rItem);
+    inline void notify(const volatile uint64_t &) {}
+
+    const bool mHasWaitPkg = fastQueueHasWaitPkg();
+};
+
+//Memory ordering policies.
+//acquire() is called after reading the position written by the other side and before touching the slots it covers.
+//releasePush() is called after writing the item(s) and before publishing the write position.
+//releasePop() is called after reading the item(s) and before publishing the read position.
+
+//Explicit hardware fences. sfence / dmb ishst before publishing the write position and lfence / dmb ishld
+//before publishing the read position. What FastQueue has always used (default).
+struct FastQueueBarrierFence {
+    static inline void acquire() {}
+
+    static inline void releasePush() {
 #if __x86_64__ || _M_X64
         _mm_sfence();
 #elif __aarch64__ || _M_ARM64
@@ -110,18 +407,61 @@ public:
 #else
 #error Architecture not supported
 #endif
-        mWritePositionPop = ++mWritePositionPush;
     }
 
-     void push(T &rItem) noexcept {
-        while (mWritePositionPush - mReadPositionPush >= RING_BUFFER_SIZE) {
-            if (mExitThreadSemaphore) {
-                return;
-            }
-        }
-        mRingBuffer[mWritePositionPush & RING_BUFFER_SIZE].mObj = std::move(rItem);
+    static inline void releasePop() {
 #if __x86_64__ || _M_X64
-        _mm_sfence();
+        _mm_lfence();
+#elif __aarch64__ || _M_ARM64
+#ifdef _MSC_VER
+        __dmb(_ARM64_BARRIER_ISHLD);
+#else
+        asm volatile("dmb ishld" : : : "memory");
+#endif
+#else
+#error Architecture not supported
+#endif
+    }
+};
+
+//C++ acquire/release fences, the compiler picks the instructions. On x86_64 no instruction is emitted
+//(compiler barrier only), on arm64 acquire is a dmb ishld and release a dmb ish.
+struct FastQueueBarrierAtomic {
+    static inline void acquire() {
+        std::atomic_thread_fence(std::memory_order_acquire);
+    }
+
+    static inline void releasePush() {
+        std::atomic_thread_fence(std::memory_order_release);
+    }
+
+    static inline void releasePop() {
+        std::atomic_thread_fence(std::memory_order_release);
+    }
+};
+
+//The minimal ordering needed per architecture.
+//x86_64 (TSO) never reorders loads with loads, stores with stores or loads with later stores, so only the
+//compiler must be stopped from reordering. arm64 needs dmb ishld after reading a position, dmb ishst
+//between writing an item and publishing it and dmb ishld between reading an item and releasing the slot.
+struct FastQueueBarrierMinimal {
+    static inline void acquire() {
+#if __x86_64__ || _M_X64
+        std::atomic_signal_fence(std::memory_order_seq_cst);
+#elif __aarch64__ || _M_ARM64
+#ifdef _MSC_VER
+        __dmb(_ARM64_BARRIER_ISHLD);
+#else
+        asm volatile("dmb ishld" : : : "memory");
+#endif
+#else
+#error Architecture not supported
+#endif
+    }
+
+    static inline void releasePush() {
+#if __x86_64__ || _M_X64
+        std::atomic_signal_fence(std::memory_order_seq_cst);
 #elif __aarch64__ || _M_ARM64
 #ifdef _MSC_VER
         __dmb(_ARM64_BARRIER_ISHST);
@@ -131,25 +471,444 @@ public:
 #else
 #error Architecture not supported
 #endif
-         mWritePositionPop = ++mWritePositionPush;
     }
 
-    void pushRaw(T &rItem) noexcept {
-        while (mWritePositionPush - mReadPositionPush >= RING_BUFFER_SIZE) {
+    static inline void releasePop() {
+#if __x86_64__ || _M_X64
+        std::atomic_signal_fence(std::memory_order_seq_cst);
+#elif __aarch64__ || _M_ARM64
+#ifdef _MSC_VER
+        __dmb(_ARM64_BARRIER_ISHLD);
+#else
+        asm volatile("dmb ishld" : : : "memory");
+#endif
+#else
+#error Architecture not supported
+#endif
+    }
+};
+
+//Instrumentation policies. The producer part is placed next to the producer position and the consumer part
+//next to the consumer position, so counting never adds cache line traffic between the threads. The shared part
+//is placed after the ring buffer and is written by the producer and read by the consumer, like the ring buffer.
+//pushed() is called before aCount items from position aPosition are published, with the occupancy seen by the
+//producer after the push. popped() is called before aCount items from position aPosition are released.
+//full() / empty() are called every time the producer / consumer finds the queue full / empty, in push() and
+//pop() that is once for every spin.
+//maxDepth() is the deepest queue the policy supports.
+
+//No instrumentation (default). Compiles to nothing.
+struct FastQueueNoStats {
+    struct Shared {
+    };
+
+    struct Producer {
+        inline void pushed(Shared &, uint64_t, uint64_t, uint64_t) {}
+        inline void full() {}
+    };
+
+    struct Consumer {
+        inline void popped(Shared &, uint64_t, uint64_t) {}
+        inline void empty() {}
+    };
+
+    static constexpr uint64_t maxDepth() {
+        return UINT64_MAX;
+    }
+};
+
+//Counters for sizing the queue. The occupancy is the producers view using its cached copy of the consumer
+//position, so it may be higher than the real occupancy but never lower.
+//Bucket 0 of the occupancy histogram counts pushes seen with occupancy 1, bucket n occupancy 2^n to 2^(n+1)-1.
+//Read the counters with producerStats() / consumerStats(), from another thread the values are a snapshot.
+struct FastQueueStats {
+    struct Shared {
+    };
+
+    struct Producer {
+        inline void pushed(Shared &, uint64_t, uint64_t aCount, uint64_t aOccupancy) {
+            mPushes += aCount;
+            if (aOccupancy > mMaxOccupancy) {
+                mMaxOccupancy = aOccupancy;
+            }
+            mOccupancyHistogram[occupancyBucket(aOccupancy)]++;
+        }
+
+        inline void full() {
+            mFullSpins++;
         }
-        mRingBuffer[mWritePositionPush & RING_BUFFER_SIZE].mObj = std::move(rItem);
+
+        static inline uint64_t occupancyBucket(uint64_t aOccupancy) {
+#ifdef _MSC_VER
+            unsigned long lIndex;
+            _BitScanReverse64(&lIndex, aOccupancy | 1);
+            return lIndex;
+#else
+            return 63 - __builtin_clzll(aOccupancy | 1);
+#endif
+        }
+
+        uint64_t mPushes = 0;
+        uint64_t mFullSpins = 0;
+        uint64_t mMaxOccupancy = 0;
+        uint64_t mOccupancyHistogram[64] = {};
+    };
+
+    struct Consumer {
+        inline void popped(Shared &, uint64_t, uint64_t aCount) {
+            mPops += aCount;
+        }
+
+        inline void empty() {
+            mEmptySpins++;
+        }
+
+        uint64_t mPops = 0;
+        uint64_t mEmptySpins = 0;
+    };
+
+    static constexpr uint64_t maxDepth() {
+        return UINT64_MAX;
+    }
+};
+
+//Cheap timestamp. The TSC on x86_64 and the virtual counter (cntvct_el0) on arm64.
+inline uint64_t fastQueueTicks() {
 #if __x86_64__ || _M_X64
-        _mm_sfence();
+    return __rdtsc();
 #elif __aarch64__ || _M_ARM64
-        #ifdef _MSC_VER
-        __dmb(_ARM64_BARRIER_ISHST);
+#ifdef _MSC_VER
+    return _ReadStatusReg(ARM64_CNTVCT);
 #else
-        asm volatile("dmb ishst" : : : "memory");
+    uint64_t lTicks;
+    asm volatile("mrs %0, cntvct_el0" : "=r"(lTicks));
+    return lTicks;
 #endif
 #else
 #error Architecture not supported
 #endif
+}
+
+//Nanoseconds per tick. Measured against the steady clock the first time it is called (takes 10ms).
+inline double fastQueueNsPerTick() {
+    static double sNsPerTick = [] {
+        auto lStart = std::chrono::steady_clock::now();
+        uint64_t lTicksStart = fastQueueTicks();
+        std::this_thread::sleep_for(std::chrono::milliseconds(10));
+        uint64_t lTicks = fastQueueTicks() - lTicksStart;
+        double lNs = std::chrono::duration<double, std::nano>(std::chrono::steady_clock::now() - lStart).count();
+        return lTicks ? lNs / (double) lTicks : 1.0;
+    }();
+    return sNsPerTick;
+}
+
+//Log bucketed histogram of tick counts, 0 - 7 exact then 8 buckets per power of two (at most 12.5% error).
+//Fixed size whatever the number of samples. Percentiles are the upper bound of the bucket holding them.
+struct FastQueueLatencyHistogram {
+    static constexpr uint64_t BUCKETS = 496;
+
+    inline void add(uint64_t aTicks) {
+        mHistogram[bucket(aTicks)]++;
+        mSamples++;
+        mSumTicks += (double) aTicks;
+        mSumSquares += (double) aTicks * (double) aTicks;
+        if (aTicks > mMaxTicks) {
+            mMaxTicks = aTicks;
+        }
+        if (aTicks < mMinTicks) {
+            mMinTicks = aTicks;
+        }
+    }
+
+    void merge(const FastQueueLatencyHistogram &rOther) {
+        for (uint64_t i = 0; i < BUCKETS; i++) {
+            mHistogram[i] += rOther.mHistogram[i];
+        }
+        mSamples += rOther.mSamples;
+        mSumTicks += rOther.mSumTicks;
+        mSumSquares += rOther.mSumSquares;
+        mMaxTicks = rOther.mMaxTicks > mMaxTicks ? rOther.mMaxTicks : mMaxTicks;
+        mMinTicks = rOther.mMinTicks < mMinTicks ? rOther.mMinTicks : mMinTicks;
+    }
+
+    //aPercentile 0.0 - 1.0. The upper bound of the bucket holding the percentile.
+    uint64_t percentileNs(double aPercentile) const {
+        if (!mSamples) {
+            return 0;
+        }
+        auto lTarget = (uint64_t) (aPercentile * (double) (mSamples - 1)) + 1;
+        uint64_t lSeen = 0;
+        for (uint64_t i = 0; i < BUCKETS; i++) {
+            lSeen += mHistogram[i];
+            if (lSeen >= lTarget) {
+                uint64_t lTicks = bucketUpperBound(i) < mMaxTicks ? bucketUpperBound(i) : mMaxTicks;
+                return (uint64_t) ((double) lTicks * fastQueueNsPerTick());
+            }
+        }
+        return maxNs();
+    }
+
+    uint64_t maxNs() const {
+        return (uint64_t) ((double) mMaxTicks * fastQueueNsPerTick());
+    }
+
+    uint64_t minNs() const {
+        return mSamples ? (uint64_t) ((double) mMinTicks * fastQueueNsPerTick()) : 0;
+    }
+
+    double meanNs() const {
+        return mSamples ? mSumTicks / (double) mSamples * fastQueueNsPerTick() : 0;
+    }
+
+    //Sample standard deviation
+    double stdDevNs() const {
+        if (mSamples < 2) {
+            return 0;
+        }
+        double lMean = mSumTicks / (double) mSamples;
+        double lVariance = (mSumSquares - lMean * mSumTicks) / (double) (mSamples - 1);
+        return lVariance > 0 ? std::sqrt(lVariance) * fastQueueNsPerTick() : 0;
+    }
+
+    uint64_t samples() const {
+        return mSamples;
+    }
+
+    static inline uint64_t bucket(uint64_t aTicks) {
+        if (aTicks < 8) {
+            return aTicks;
+        }
+#ifdef _MSC_VER
+        unsigned long lMsb;
+        _BitScanReverse64(&lMsb, aTicks);
+#else
+        uint64_t lMsb = 63 - __builtin_clzll(aTicks);
+#endif
+        return (lMsb - 2) * 8 + ((aTicks >> (lMsb - 3)) & 7);
+    }
+
+    static inline uint64_t bucketUpperBound(uint64_t aBucket) {
+        if (aBucket < 8) {
+            return aBucket;
+        }
+        uint64_t lShift = aBucket / 8 - 1;
+        return ((8 + (aBucket & 7)) << lShift) + (1ULL << lShift) - 1;
+    }
+
+    uint64_t mSamples = 0;
+    uint64_t mMaxTicks = 0;
+    uint64_t mMinTicks = UINT64_MAX;
+    double mSumTicks = 0;
+    double mSumSquares = 0;
+    uint64_t mHistogram[BUCKETS] = {};
+};
+
+//Time in queue (sojourn time). Every SAMPLE_EVERY position is stamped by the producer when pushed and the
+//consumer adds the time since the stamp to a FastQueueLatencyHistogram when popped (8 buckets per power of two,
+//at most 12.5% error). The stamps are kept in STAMP_SLOTS slots so the queue can be at most
+//SAMPLE_EVERY * STAMP_SLOTS - 1 deep. Read the result with consumerStats().percentileNs(0.99) / maxNs().
+template<uint64_t SAMPLE_EVERY = 64, uint64_t STAMP_SLOTS = 1024>
+struct FastQueueLatencyStats {
+    static_assert(SAMPLE_EVERY && !(SAMPLE_EVERY & (SAMPLE_EVERY - 1)), "SAMPLE_EVERY must be a power of two");
+    static_assert(STAMP_SLOTS && !(STAMP_SLOTS & (STAMP_SLOTS - 1)), "STAMP_SLOTS must be a power of two");
+
+    struct Shared {
+        uint64_t mStamps[STAMP_SLOTS] = {};
+    };
+
+    struct Producer {
+        inline void pushed(Shared &rShared, uint64_t aPosition, uint64_t aCount, uint64_t) {
+            uint64_t lSample = firstSample(aPosition);
+            if (lSample - aPosition >= aCount) {
+                return;
+            }
+            uint64_t lNow = fastQueueTicks();
+            for (; lSample - aPosition < aCount; lSample += SAMPLE_EVERY) {
+                rShared.mStamps[(lSample / SAMPLE_EVERY) & (STAMP_SLOTS - 1)] = lNow;
+            }
+        }
+
+        inline void full() {}
+    };
+
+    struct Consumer : FastQueueLatencyHistogram {
+        inline void popped(Shared &rShared, uint64_t aPosition, uint64_t aCount) {
+            uint64_t lSample = firstSample(aPosition);
+            if (lSample - aPosition >= aCount) {
+                return;
+            }
+            uint64_t lNow = fastQueueTicks();
+            for (; lSample - aPosition < aCount; lSample += SAMPLE_EVERY) {
+                uint64_t lStamp = rShared.mStamps[(lSample / SAMPLE_EVERY) & (STAMP_SLOTS - 1)];
+                add(lNow > lStamp ? lNow - lStamp : 0);
+            }
+        }
+
+        inline void empty() {}
+    };
+
+    static constexpr uint64_t maxDepth() {
+        return SAMPLE_EVERY * STAMP_SLOTS - 1;
+    }
+
+    static inline uint64_t firstSample(uint64_t aPosition) {
+        return (aPosition + SAMPLE_EVERY - 1) & ~(SAMPLE_EVERY - 1);
+    }
+};
+
+template<typename T, uint64_t RING_BUFFER_SIZE, uint64_t L1_CACHE_LNE, FastQueueLayout LAYOUT = FastQueueLayout::PADDED,
+        typename WAIT_STRATEGY = FastQueueWaitBusy, typename BARRIER = FastQueueBarrierFence,
+        typename STATS = FastQueueNoStats, FastQueuePositions POSITIONS = FastQueuePositions::CACHED>
+class FastQueue {
+public:
+
+    enum class FastQueueMessages : uint64_t {
+        END_OF_SERVICE,
+        READY_TO_POP,
+        NOT_READY_TO_POP,
+        READY_TO_PUSH,
+        NOT_READY_TO_PUSH,
+    };
+
+    explicit FastQueue() {
+        static_assert(RING_BUFFER_SIZE != 0, "A FastQueue with RING_BUFFER_SIZE 0 is sized by FastQueue(aRingBufferSize)");
+        verifyBufferMask(RING_BUFFER_SIZE);
+        if ((uint64_t) &mWritePositionPush % 8 || (uint64_t) &mReadPositionPop % 8) {
+            throw std::runtime_error("Queue-pointers are misaligned in memory.");
+        }
+    }
+
+    //Runtime sized queue (RING_BUFFER_SIZE set to 0)
+    //aRingBufferSize is the size of the queue as a contiguous bitmask from LSB, same as RING_BUFFER_SIZE
+    //aMemory FastQueueMemory::HUGE_PAGES backs the ring buffer with huge pages where supported
+    //aNuma.mRingNode binds the ring buffer to a NUMA node
+    explicit FastQueue(uint64_t aRingBufferSize, FastQueueMemory aMemory = FastQueueMemory::DEFAULT,
+                       FastQueueNuma aNuma = {}) {
+        static_assert(RING_BUFFER_SIZE == 0, "Only a FastQueue with RING_BUFFER_SIZE 0 can be sized at runtime");
+        verifyBufferMask(aRingBufferSize);
+        if ((uint64_t) &mWritePositionPush % 8 || (uint64_t) &mReadPositionPop % 8) {
+            throw std::runtime_error("Queue-pointers are misaligned in memory.");
+        }
+        mRingMask = aRingBufferSize;
+        mRingBytes = (aRingBufferSize + 1) * sizeof(mSlot);
+        mRingBuffer = (mSlot *) allocateRing(mRingBytes, aMemory);
+        if (!mRingBuffer) {
+            throw std::runtime_error("Failed allocating the ring buffer.");
+        }
+        if (!fastQueueBindNode(mRingBuffer, mRingBytes, aNuma.mRingNode)) {
+            freeRing(mRingBuffer, mRingBytes);
+            throw std::runtime_error("Failed binding the ring buffer to the NUMA node.");
+        }
+        //Constructing the slots also pre-faults the pages so the queue does not take page faults when running
+        for (uint64_t i = 0; i <= mRingMask; i++) {
+            new(&mRingBuffer[i]) mSlot();
+        }
+    }
+
+    ~FastQueue() {
+        if constexpr (RING_BUFFER_SIZE == 0) {
+            for (uint64_t i = 0; i <= mRingMask; i++) {
+                mRingBuffer[i].~mSlot();
+            }
+            freeRing(mRingBuffer, mRingBytes);
+        }
+    }
+
+    ///////////////////////
+    /// Push part
+    ///////////////////////
+
+    FastQueueMessages tryPush() {
+        if (isFull() || mExitThreadSemaphore) {
+            return FastQueueMessages::NOT_READY_TO_PUSH;
+        }
+        return FastQueueMessages::READY_TO_PUSH;
+    }
+
+    void pushAfterTry(T &rItem) {
+        mRingBuffer[mWritePositionPush & bufferMask()].mObj = std::move(rItem);
+        mProducerStats.pushed(mSharedStats, mWritePositionPush, 1, mWritePositionPush + 1 - mReadPositionCache);
+        BARRIER::releasePush();
         mWritePositionPop = ++mWritePositionPush;
+        mWaitStrategy.notify(mWritePositionPop);
+    }
+
+     void push(T &rItem) noexcept {
+        uint64_t lSpins = 0;
+        while (isFull()) {
+            if (mExitThreadSemaphore) {
+                return;
+            }
+            mWaitStrategy.wait(mReadPositionPush, mReadPositionCache, lSpins++);
+        }
+        mRingBuffer[mWritePositionPush & bufferMask()].mObj = std::move(rItem);
+        mProducerStats.pushed(mSharedStats, mWritePositionPush, 1, mWritePositionPush + 1 - mReadPositionCache);
+        BARRIER::releasePush();
+         mWritePositionPop = ++mWritePositionPush;
+         mWaitStrategy.notify(mWritePositionPop);
+    }
+
+    void pushRaw(T &rItem) noexcept {
+        uint64_t lSpins = 0;
+        while (isFull()) {
+            mWaitStrategy.wait(mReadPositionPush, mReadPositionCache, lSpins++);
+        }
+        mRingBuffer[mWritePositionPush & bufferMask()].mObj = std::move(rItem);
+        mProducerStats.pushed(mSharedStats, mWritePositionPush, 1, mWritePositionPush + 1 - mReadPositionCache);
+        BARRIER::releasePush();
+        mWritePositionPop = ++mWritePositionPush;
+        mWaitStrategy.notify(mWritePositionPop);
+    }
+
+    //Push as many items from [aFirst, aLast) as there is room for. The items are moved into the queue.
+    //The fence and the index publish is done once for the whole batch.
+    //Returns the number of items pushed (0 if the queue is full or stopped).
+    template<typename ITERATOR>
+    uint64_t pushBulk(ITERATOR aFirst, ITERATOR aLast) noexcept {
+        if (mExitThreadSemaphore) {
+            return 0;
+        }
+        uint64_t lWritePosition = mWritePositionPush;
+        uint64_t lCount = 0;
+        while (aFirst != aLast) {
+            if (!cachedPositions() || lWritePosition - mReadPositionCache >= bufferMask()) {
+                mReadPositionCache = mReadPositionPush;
+                BARRIER::acquire();
+                if (lWritePosition - mReadPositionCache >= bufferMask()) {
+                    mProducerStats.full();
+                    break;
+                }
+            }
+            mRingBuffer[lWritePosition++ & bufferMask()].mObj = std::move(*aFirst);
+            ++aFirst;
+            ++lCount;
+        }
+        if (!lCount) {
+            return 0;
+        }
+        mProducerStats.pushed(mSharedStats, mWritePositionPush, lCount, lWritePosition - mReadPositionCache);
+        BARRIER::releasePush();
+        mWritePositionPush = lWritePosition;
+        mWritePositionPop = lWritePosition;
+        mWaitStrategy.notify(mWritePositionPop);
+        return lCount;
+    }
+
+    //Zero-copy push. Returns a pointer to the next free slot in the ring buffer or nullptr if the
+    //queue is full or stopped. Build the item in place and then call commitPush().
+    T *reservePush() noexcept {
+        if (isFull() || mExitThreadSemaphore) {
+            return nullptr;
+        }
+        return &mRingBuffer[mWritePositionPush & bufferMask()].mObj;
+    }
+
+    //Publish the item built in the slot returned by reservePush()
+    void commitPush() noexcept {
+        mProducerStats.pushed(mSharedStats, mWritePositionPush, 1, mWritePositionPush + 1 - mReadPositionCache);
+        BARRIER::releasePush();
+        mWritePositionPop = ++mWritePositionPush;
+        mWaitStrategy.notify(mWritePositionPop);
     }
 
     ///////////////////////
@@ -157,7 +916,7 @@ public:
     ///////////////////////
 
     FastQueueMessages tryPop() {
-        if (mWritePositionPop == mReadPositionPop) {
+        if (isEmpty()) {
             if ((mExitThread == mReadPositionPop) && mExitThreadSemaphore) {
                 return FastQueueMessages::END_OF_SERVICE;
             }
@@ -167,66 +926,98 @@ public:
     }
 
     T popAfterTry() {
-        T lData = std::move(mRingBuffer[mReadPositionPop & RING_BUFFER_SIZE].mObj);
-#if __x86_64__ || _M_X64
-        _mm_lfence();
-#elif __aarch64__ || _M_ARM64
-#ifdef _MSC_VER
-        __dmb(_ARM64_BARRIER_ISHLD);
-#else
-        asm volatile("dmb ishld" : : : "memory");
-#endif
-#else
-#error Architecture not supported
-#endif
+        T lData = std::move(mRingBuffer[mReadPositionPop & bufferMask()].mObj);
+        mConsumerStats.popped(mSharedStats, mReadPositionPop, 1);
+        BARRIER::releasePop();
         mReadPositionPush = ++mReadPositionPop;
+        mWaitStrategy.notify(mReadPositionPush);
         return lData;
     }
 
      T pop() noexcept {
-        while (mWritePositionPop == mReadPositionPop) {
+        uint64_t lSpins = 0;
+        while (isEmpty()) {
             if ((mExitThread == mReadPositionPop) && mExitThreadSemaphore) {
                 return {};
             }
+            mWaitStrategy.wait(mWritePositionPop, mWritePositionCache, lSpins++);
         }
-        T lData = std::move(mRingBuffer[mReadPositionPop & RING_BUFFER_SIZE].mObj);
-#if __x86_64__ || _M_X64
-         _mm_lfence();
-#elif __aarch64__ || _M_ARM64
-#ifdef _MSC_VER
-         __dmb(_ARM64_BARRIER_ISHLD);
-#else
-         asm volatile("dmb ishld" : : : "memory");
-#endif
-#else
-#error Architecture not supported
-#endif
+        T lData = std::move(mRingBuffer[mReadPositionPop & bufferMask()].mObj);
+         mConsumerStats.popped(mSharedStats, mReadPositionPop, 1);
+         BARRIER::releasePop();
          mReadPositionPush = ++mReadPositionPop;
+         mWaitStrategy.notify(mReadPositionPush);
          return lData;
     }
 
     void popRaw(T& out) noexcept {
-        while (mWritePositionPop == mReadPositionPop) {
+        uint64_t lSpins = 0;
+        while (isEmpty()) {
+            mWaitStrategy.wait(mWritePositionPop, mWritePositionCache, lSpins++);
         }
-        out = std::move(mRingBuffer[mReadPositionPop & RING_BUFFER_SIZE].mObj);
-#if __x86_64__ || _M_X64
-        _mm_lfence();
-#elif __aarch64__ || _M_ARM64
-        #ifdef _MSC_VER
-         __dmb(_ARM64_BARRIER_ISHLD);
-#else
-         asm volatile("dmb ishld" : : : "memory");
-#endif
-#else
-#error Architecture not supported
-#endif
+        out = std::move(mRingBuffer[mReadPositionPop & bufferMask()].mObj);
+        mConsumerStats.popped(mSharedStats, mReadPositionPop, 1);
+        BARRIER::releasePop();
+        mReadPositionPush = ++mReadPositionPop;
+        mWaitStrategy.notify(mReadPositionPush);
+    }
+
+    //Pop up to aMaxCount items to aOut. The items are moved out of the queue.
+    //The fence and the index publish is done once for the whole batch.
+    //Returns the number of items popped. 0 means the queue is empty, use tryPop() to
+    //see if the queue is also stopped (END_OF_SERVICE).
+    template<typename OUTPUT_ITERATOR>
+    uint64_t popBulk(OUTPUT_ITERATOR aOut, uint64_t aMaxCount) noexcept {
+        uint64_t lReadPosition = mReadPositionPop;
+        uint64_t lCount = 0;
+        while (lCount < aMaxCount) {
+            if (!cachedPositions() || lReadPosition == mWritePositionCache) {
+                mWritePositionCache = mWritePositionPop;
+                BARRIER::acquire();
+                if (lReadPosition == mWritePositionCache) {
+                    mConsumerStats.empty();
+                    break;
+                }
+            }
+            *aOut = std::move(mRingBuffer[lReadPosition++ & bufferMask()].mObj);
+            ++aOut;
+            ++lCount;
+        }
+        if (!lCount) {
+            return 0;
+        }
+        mConsumerStats.popped(mSharedStats, mReadPositionPop, lCount);
+        BARRIER::releasePop();
+        mReadPositionPop = lReadPosition;
+        mReadPositionPush = lReadPosition;
+        mWaitStrategy.notify(mReadPositionPush);
+        return lCount;
+    }
+
+    //Zero-copy pop. Returns a pointer to the next item in the ring buffer or nullptr if the queue is
+    //empty, use tryPop() to see if the queue is also stopped (END_OF_SERVICE). Read the item in place and
+    //then call release(). The item is left in the slot and is overwritten by a later push.
+    const T *peek() noexcept {
+        if (isEmpty()) {
+            return nullptr;
+        }
+        return &mRingBuffer[mReadPositionPop & bufferMask()].mObj;
+    }
+
+    //Hand the slot returned by peek() back to the producer
+    void release() noexcept {
+        mConsumerStats.popped(mSharedStats, mReadPositionPop, 1);
+        BARRIER::releasePop();
         mReadPositionPush = ++mReadPositionPop;
+        mWaitStrategy.notify(mReadPositionPush);
     }
 
     //Stop queue (Maybe called from any thread)
     void stopQueue() {
         mExitThread = mWritePositionPush;
         mExitThreadSemaphore = true;
+        mWaitStrategy.notify(mWritePositionPop);
+        mWaitStrategy.notify(mReadPositionPush);
     }
 
     //Is the queue stopped?
@@ -234,25 +1025,207 @@ public:
         return mExitThreadSemaphore;
     }
 
+    //Counters of the instrumentation policy
+    const typename STATS::Producer &producerStats() const {
+        return mProducerStats;
+    }
+
+    const typename STATS::Consumer &consumerStats() const {
+        return mConsumerStats;
+    }
+
+    //Offset of the first line written by the consumer, the lines before it are the producers.
+    //fastQueueNewOnNodes() places the two parts on their own pages.
+    static constexpr uint64_t consumerLinesOffset() {
+        return offsetof(FastQueue, mReadPositionPop);
+    }
+
     ///Delete copy and move constructors and assign operators
     FastQueue(FastQueue const &) = delete;              // Copy construct
     FastQueue(FastQueue &&) = delete;                   // Move construct
     FastQueue &operator=(FastQueue const &) = delete;   // Copy assign
     FastQueue &operator=(FastQueue &&) = delete;        // Move assign
 private:
-    struct alignas(L1_CACHE_LNE) mAlign {
-        T mObj;
-        volatile uint8_t mStuff[L1_CACHE_LNE - sizeof(T)];
-    };
+    inline uint64_t bufferMask() const {
+        if constexpr (RING_BUFFER_SIZE != 0) {
+            return RING_BUFFER_SIZE;
+        } else {
+            return mRingMask;
+        }
+    }
+
+    static void verifyBufferMask(uint64_t aMask) {
+        fastQueueVerifyBufferMask(aMask);
+        if (aMask > STATS::maxDepth()) {
+            throw std::runtime_error("The queue is deeper than the instrumentation policy supports.");
+        }
+    }
+
+    //Allocate the ring buffer of a runtime sized queue. rBytes is updated to the size actually mapped.
+    static void *allocateRing(uint64_t &rBytes, FastQueueMemory aMemory) {
+#if defined(__linux__) || defined(__APPLE__)
+#if defined(__linux__)
+        if (aMemory == FastQueueMemory::HUGE_PAGES) {
+            //Explicit huge pages (needs pages reserved in vm.nr_hugepages)
+            uint64_t lHugeBytes = (rBytes + FASTQUEUE_HUGE_PAGE_SIZE - 1) & ~(FASTQUEUE_HUGE_PAGE_SIZE - 1);
+            void *lpRing = mmap(nullptr, lHugeBytes, PROT_READ | PROT_WRITE,
+                                MAP_PRIVATE | MAP_ANONYMOUS | MAP_HUGETLB, -1, 0);
+            if (lpRing != MAP_FAILED) {
+                rBytes = lHugeBytes;
+                return lpRing;
+            }
+            //Fall back to transparent huge pages. Map one extra huge page so the ring can start on a
+            //huge page boundary, then give the unused head and tail back.
+            uint64_t lMapBytes = lHugeBytes + FASTQUEUE_HUGE_PAGE_SIZE;
+            auto lpMap = (uint8_t *) mmap(nullptr, lMapBytes, PROT_READ | PROT_WRITE,
+                                          MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+            if (lpMap == MAP_FAILED) {
+                return nullptr;
+            }
+            auto lpAligned = (uint8_t *) (((uint64_t) lpMap + FASTQUEUE_HUGE_PAGE_SIZE - 1) &
+                                          ~(FASTQUEUE_HUGE_PAGE_SIZE - 1));
+            uint64_t lHead = lpAligned - lpMap;
+            uint64_t lTail = lMapBytes - lHead - lHugeBytes;
+            if (lHead) munmap(lpMap, lHead);
+            if (lTail) munmap(lpAligned + lHugeBytes, lTail);
+            madvise(lpAligned, lHugeBytes, MADV_HUGEPAGE);
+            rBytes = lHugeBytes;
+            return lpAligned;
+        }
+#endif
+        void *lpRing = mmap(nullptr, rBytes, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+        return lpRing == MAP_FAILED ? nullptr : lpRing;
+#elif defined(_MSC_VER)
+        //Large pages under Windows needs the 'Lock pages in memory' privilege, use aligned heap memory.
+        return _aligned_malloc(rBytes, L1_CACHE_LNE);
+#else
+#error OS not supported
+#endif
+    }
+
+    static void freeRing(void *pRing, uint64_t aBytes) {
+#if defined(__linux__) || defined(__APPLE__)
+        munmap(pRing, aBytes);
+#elif defined(_MSC_VER)
+        _aligned_free(pRing);
+#endif
+    }
+
+    static constexpr bool cachedPositions() {
+        return POSITIONS == FastQueuePositions::CACHED;
+    }
+
+    //Full as seen by the producer. The consumer position is only fetched from the consumers
+    //cache line when the cached copy says the queue is full.
+    inline bool isFull() {
+        if (cachedPositions() && mWritePositionPush - mReadPositionCache < bufferMask()) {
+            return false;
+        }
+        mReadPositionCache = mReadPositionPush;
+        BARRIER::acquire();
+        if (mWritePositionPush - mReadPositionCache >= bufferMask()) {
+            mProducerStats.full();
+            return true;
+        }
+        return false;
+    }
+
+    //Empty as seen by the consumer. The producer position is only fetched from the producers
+    //cache line when the cached copy says the queue is empty.
+    inline bool isEmpty() {
+        if (cachedPositions() && mReadPositionPop != mWritePositionCache) {
+            return false;
+        }
+        mWritePositionCache = mWritePositionPop;
+        BARRIER::acquire();
+        if (mReadPositionPop == mWritePositionCache) {
+            mConsumerStats.empty();
+            return true;
+        }
+        return false;
+    }
+
+    using mSlot = FastQueueSlot<T, L1_CACHE_LNE, LAYOUT>;
+    //An embedded array when the size is known at compile time, a pointer to allocated memory when sized at runtime
+    using mRing = typename std::conditional<RING_BUFFER_SIZE != 0, mSlot[RING_BUFFER_SIZE + 1], mSlot *>::type;
 
     alignas(L1_CACHE_LNE) volatile uint8_t mBorderUpp[L1_CACHE_LNE];
     alignas(L1_CACHE_LNE) volatile uint64_t mWritePositionPush = 0;
+    uint64_t mReadPositionCache = 0; //Producer local copy of mReadPositionPush
+    typename STATS::Producer mProducerStats;
     alignas(L1_CACHE_LNE) volatile uint64_t mReadPositionPop = 0;
+    uint64_t mWritePositionCache = 0; //Consumer local copy of mWritePositionPop
+    typename STATS::Consumer mConsumerStats;
     alignas(L1_CACHE_LNE) volatile uint64_t mWritePositionPop = 0;
     alignas(L1_CACHE_LNE) volatile uint64_t mReadPositionPush = 0;
     alignas(L1_CACHE_LNE) volatile uint64_t mExitThread = 0;
     alignas(L1_CACHE_LNE) volatile bool mExitThreadSemaphore = false;
-    alignas(L1_CACHE_LNE) mAlign mRingBuffer[RING_BUFFER_SIZE + 1];
+    alignas(L1_CACHE_LNE) WAIT_STRATEGY mWaitStrategy;
+    alignas(L1_CACHE_LNE) mRing mRingBuffer;
+    uint64_t mRingMask = RING_BUFFER_SIZE; //Only used by runtime sized queues
+    uint64_t mRingBytes = 0; //Only used by runtime sized queues
+    typename STATS::Shared mSharedStats;
     alignas(L1_CACHE_LNE) volatile uint8_t mBorderDown[L1_CACHE_LNE];
 };
 
+//Where fastQueueNewOnNodes() puts the queue. The queue starts rShift bytes into a mapping of rBytes so the
+//consumer lines start on a page boundary.
+template<typename QUEUE>
+void fastQueueOnNodesLayout(uint64_t &rShift, uint64_t &rBytes) {
+    uint64_t lPage = fastQueuePageSize();
+    rShift = (lPage - QUEUE::consumerLinesOffset() % lPage) % lPage;
+    rBytes = (rShift + sizeof(QUEUE) + lPage - 1) & ~(lPage - 1);
+}
+
+//Create a runtime sized QUEUE with the producer lines (write position and the cached read position) on pages
+//bound to rNuma.mProducerNode and the rest of the control lines on pages bound to rNuma.mConsumerNode.
+//The ring buffer is bound to rNuma.mRingNode.
+//auto queue = fastQueueNewOnNodes<FastQueue<Type, 0, L1-Cache size>>(numa, Size);
+//fastQueueDeleteOnNodes(queue);
+template<typename QUEUE>
+QUEUE *fastQueueNewOnNodes(const FastQueueNuma &rNuma, uint64_t aRingBufferSize,
+                           FastQueueMemory aMemory = FastQueueMemory::DEFAULT) {
+    uint64_t lShift, lBytes;
+    fastQueueOnNodesLayout<QUEUE>(lShift, lBytes);
+#if defined(__linux__) || defined(__APPLE__)
+    void *lpMap = mmap(nullptr, lBytes, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+    auto lpBase = (uint8_t *) (lpMap == MAP_FAILED ? nullptr : lpMap);
+#elif defined(_MSC_VER)
+    auto lpBase = (uint8_t *) _aligned_malloc(lBytes, fastQueuePageSize());
+#endif
+    if (!lpBase) {
+        throw std::runtime_error("Failed allocating the queue.");
+    }
+    auto lFree = [lpBase, lBytes]() {
+#if defined(__linux__) || defined(__APPLE__)
+        munmap(lpBase, lBytes);
+#elif defined(_MSC_VER)
+        _aligned_free(lpBase);
+#endif
+    };
+    uint64_t lSplit = lShift + QUEUE::consumerLinesOffset();
+    if (!fastQueueBindNode(lpBase, lSplit, rNuma.mProducerNode) ||
+        !fastQueueBindNode(lpBase + lSplit, lBytes - lSplit, rNuma.mConsumerNode)) {
+        lFree();
+        throw std::runtime_error("Failed binding the queue to the NUMA nodes.");
+    }
+    try {
+        return new(lpBase + lShift) QUEUE(aRingBufferSize, aMemory, rNuma);
+    } catch (...) {
+        lFree();
+        throw;
+    }
+}
+
+template<typename QUEUE>
+void fastQueueDeleteOnNodes(QUEUE *pQueue) {
+    uint64_t lShift, lBytes;
+    fastQueueOnNodesLayout<QUEUE>(lShift, lBytes);
+    pQueue->~QUEUE();
+    auto lpBase = (uint8_t *) pQueue - lShift;
+#if defined(__linux__) || defined(__APPLE__)
+    munmap(lpBase, lBytes);
+#elif defined(_MSC_VER)
+    _aligned_free(lpBase);
+#endif
+}
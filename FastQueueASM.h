@@ -5,14 +5,26 @@
 #pragma once
 
 #include <cstdint>
+#include <cstring>
+#include <bitset>
+#include <stdexcept>
 #include <iostream>
 #include <cstdlib>
 #include <memory>
+#include "FastQueue.h"
 #ifdef _MSC_VER
 #include <malloc.h>
 #endif
+#if __aarch64__ || _M_ARM64
+#if defined(__linux__)
+#include <sys/auxv.h>
+#elif defined(__APPLE__)
+#include <sys/sysctl.h>
+#endif
+#endif
 
-//Remember to set the parameters in the ASM file as well if changed
+//The queue depth is set per queue by newQueue(mask), BUFFER_MASK is the depth of newQueue()
+//Remember to set the cache line size in the ASM file as well if changed
 #define BUFFER_MASK 15
 #define L1_CACHE 64
 
@@ -25,14 +37,88 @@ namespace FastQueueASM {
     void push_item(void *, void *);
     //param1 = pointer to the struct FastQueueASM::DataBlock, returns the pointer, or NULL if last item is popped
     void *pop_item(void *);
-    //param1 = the mask used by the C header file, returns 0 if the ASM queue and C buffer size match
-    uint64_t verify_mask(uint64_t);
     //param1 = the cache size used by the C header file, returns 0 if the ASM cache size and C cache size setting match
     uint64_t verify_cache_size(uint64_t);
+    //Non blocking push, returns 1 if pushed and 0 if the queue is full or stopped
+    uint64_t try_push_item(void *, void *);
+    //Non blocking pop, param2 = where to store the pointer. Returns one of TryPopResult
+    uint64_t try_pop_item(void *, void **);
+    //param2 = the pointers, param3 = count. Pushes as many as there is room for, the fence and the index publish
+    //is done once for the batch. Returns the number pushed (0 if the queue is full or stopped)
+    uint64_t push_items(void *, void **, uint64_t);
+    //param2 = where to store the pointers, param3 = max count. The fence and the index publish is done once for
+    //the batch. Returns the number popped, 0 means the queue is empty, use try_pop_item to see if it is also stopped
+    uint64_t pop_items(void *, void **, uint64_t);
+#if __x86_64__ || _M_X64
+    //Same as pop_item waiting in UMWAIT on mWritePositionPop when the queue is empty (needs WAITPKG)
+    void *pop_item_umwait(void *);
+    //Same as pop_item with a pause in the empty loop
+    void *pop_item_pause(void *);
+#endif
+#if __aarch64__ || _M_ARM64
+    //Same as push_item / pop_item using stlr and ldapr (needs FEAT_LRCPC) instead of dmb.
+    //pop waits in wfe when the queue is empty.
+    void push_item_lrcpc(void *, void *);
+    void *pop_item_lrcpc(void *);
+    //Same as the lrcpc version using ldar, for CPUs without FEAT_LRCPC
+    void push_item_acqrel(void *, void *);
+    void *pop_item_acqrel(void *);
+#endif
+    }
+
+    using PushFunction = void (*)(void *, void *);
+    using PopFunction = void *(*)(void *);
+
+#if __aarch64__ || _M_ARM64
+    //Does the CPU have FEAT_LRCPC (ldapr)
+    inline bool hasLrcpc() {
+#if defined(__linux__)
+#ifndef HWCAP_LRCPC
+#define HWCAP_LRCPC (1 << 15)
+#endif
+        return getauxval(AT_HWCAP) & HWCAP_LRCPC;
+#elif defined(__APPLE__)
+        int lValue = 0;
+        size_t lSize = sizeof(lValue);
+        if (sysctlbyname("hw.optional.arm.FEAT_LRCPC", &lValue, &lSize, nullptr, 0)) {
+            return false;
+        }
+        return lValue;
+#else
+        return false;
+#endif
+    }
+
+    //The acquire/release push and pop for this CPU
+    inline PushFunction pushItemAcqRel() {
+        return hasLrcpc() ? push_item_lrcpc : push_item_acqrel;
+    }
+
+    inline PopFunction popItemAcqRel() {
+        return hasLrcpc() ? pop_item_lrcpc : pop_item_acqrel;
+    }
+#endif
+
+    //The pop for this CPU that waits in hardware instead of polling the queue when it is empty.
+    //UMWAIT if the CPU has WAITPKG else pause (x86), wfe (arm64)
+    inline PopFunction popItemWait() {
+#if __x86_64__ || _M_X64
+        return fastQueueHasWaitPkg() ? pop_item_umwait : pop_item_pause;
+#else
+        return popItemAcqRel();
+#endif
     }
 
+    //try_pop_item return values
+    enum TryPopResult : uint64_t {
+        NOT_READY_TO_POP = 0,
+        ITEM_POPPED = 1,
+        END_OF_SERVICE = 2
+    };
+
     //The data block 'template' used by the queue
-    //Block is set to 0 after initialised
+    //Block is set to 0 after initialised. The ring buffer holds mMask + 1 entries and is followed by a
+    //border line, the block is allocated by newQueue().
     struct DataBlock {
         struct alignas(L1_CACHE) mAlign {
             void *mObj;
@@ -46,39 +132,45 @@ namespace FastQueueASM {
         alignas(L1_CACHE) volatile uint64_t mReadPositionPop;  //L1CACHE * 4
         alignas(L1_CACHE) volatile uint64_t mExitThread; //L1CACHE * 5
         alignas(L1_CACHE) volatile uint64_t mExitThreadSemaphore; //L1CACHE * 6
-        alignas(L1_CACHE) volatile mAlign mRingBuffer[BUFFER_MASK + 1]; //L1CACHE * 7
-        alignas(L1_CACHE) volatile uint8_t mBorderDown[L1_CACHE];
+        alignas(L1_CACHE) uint64_t mMask; //L1CACHE * 7 (read only, shared by both sides)
+        alignas(L1_CACHE) volatile mAlign mRingBuffer[1]; //L1CACHE * 8
     };
 
+    //Bytes allocated for a queue of aMask
+    inline uint64_t blockSize(uint64_t aMask) {
+        //The ring plus the border line after it
+        return sizeof(DataBlock) + aMask * L1_CACHE + L1_CACHE;
+    }
+
     //Allocate an new queue
-    DataBlock *newQueue() {
+    //aMask is the size of the queue as a contiguous bitmask from LSB example 0b1111
+    DataBlock *newQueue(uint64_t aMask = BUFFER_MASK) {
 
         //Verify the compiler generated data block
-        static_assert(sizeof(DataBlock) == ((6 * L1_CACHE) + ((BUFFER_MASK + 1) * L1_CACHE) + (L1_CACHE * 2)),
+        static_assert(sizeof(DataBlock) == ((8 * L1_CACHE) + L1_CACHE),
                       "FastQueueASM::DataBlock is not matching expected size");
-#ifdef _MSC_VER
-        auto pData = (DataBlock *)_aligned_malloc(sizeof(DataBlock), L1_CACHE);
-#else
-        auto pData = (DataBlock *)std::aligned_alloc(L1_CACHE, sizeof(DataBlock));
-#endif
-        if (pData) std::memset((void *) pData, 0, sizeof(DataBlock));
-
-        uint64_t lSource = BUFFER_MASK;
+        uint64_t lSource = aMask;
         uint64_t lContiguousBits = 0;
         while (true) {
             if (!(lSource & 1)) break;
             lSource = lSource >> 1;
             lContiguousBits++;
         }
-        uint64_t lBitsSetTotal = std::bitset<64>(BUFFER_MASK).count();
+        uint64_t lBitsSetTotal = std::bitset<64>(aMask).count();
         if (lContiguousBits != lBitsSetTotal || !lContiguousBits)
             throw std::runtime_error(
                     "Buffer size must be a number of contiguous bits set from LSB. Example: 0b00001111 not 0b01001111");
-        if (verify_mask(BUFFER_MASK))
-            throw std::runtime_error("the buffer size in fast queue ASM and C-header missmatch.");
         if (std::bitset<64>(L1_CACHE).count() != 1) throw std::runtime_error("L1_CACHE must be a 2 complement number ( 2pow(6) = 64 )");
         if (verify_cache_size(L1_CACHE))
             throw std::runtime_error("the cache size in fast queue ASM and C-header missmatch.");
+#ifdef _MSC_VER
+        auto pData = (DataBlock *)_aligned_malloc(blockSize(aMask), L1_CACHE);
+#else
+        auto pData = (DataBlock *)std::aligned_alloc(L1_CACHE, blockSize(aMask));
+#endif
+        if (!pData) throw std::runtime_error("Failed allocating the queue.");
+        std::memset((void *) pData, 0, blockSize(aMask));
+        pData->mMask = aMask;
         return pData;
     }
 
@@ -95,6 +187,10 @@ namespace FastQueueASM {
     void stopQueue(DataBlock *pData) {
         pData->mExitThread = pData->mWritePositionPush;
         pData->mExitThreadSemaphore = true;
+#if (__aarch64__ || _M_ARM64) && !defined(_MSC_VER)
+        //Wake a consumer waiting in wfe (pop_item_lrcpc / pop_item_acqrel)
+        asm volatile ("dsb ish\n\tsev" ::: "memory");
+#endif
     }
 
     //Is the queue stopped?
@@ -0,0 +1,266 @@
+//
+// Created by Anders Cedronius
+//
+
+// Usage
+
+// Single producer multi consumer broadcast queue. Every consumer sees every item.
+// auto queue = FastQueueBroadcast<Type, Consumers, Size, L1-Cache size>
+// Consumers is the number of consumers, every consumer must keep popping or the producer stalls
+// Size, L1-Cache size and the optional layout, wait strategy and barrier policy are the FastQueue parameters
+
+// The producer writes every item once and publishes it with one fence and one store, no matter the number of
+// consumers. Every consumer has its own read cursor on its own cache line. The producer gates on the slowest
+// cursor and caches it, the cursors are only read when the cached slowest cursor says the queue is full.
+
+// Producer
+// queue.push(object)
+// queue.pushBulk(first, last) / queue.reservePush() + queue.commitPush()
+
+// Consumer number 0 - (Consumers - 1)
+// auto result = queue.pop(consumer); (a copy of the item, {} when the queue is stopped and drained)
+// queue.popBulk(consumer, out, maxCount) / queue.peek(consumer) + queue.release(consumer)
+
+// Call queue.stopQueue() from any thread to signal end of transaction
+
+#pragma once
+
+#include "FastQueue.h"
+
+template<typename T, uint64_t CONSUMERS, uint64_t RING_BUFFER_SIZE, uint64_t L1_CACHE_LNE,
+        FastQueueLayout LAYOUT = FastQueueLayout::PADDED, typename WAIT_STRATEGY = FastQueueWaitBusy,
+        typename BARRIER = FastQueueBarrierFence>
+class FastQueueBroadcast {
+public:
+
+    enum class FastQueueMessages : uint64_t {
+        END_OF_SERVICE,
+        READY_TO_POP,
+        NOT_READY_TO_POP,
+    };
+
+    explicit FastQueueBroadcast() {
+        fastQueueVerifyBufferMask(RING_BUFFER_SIZE);
+    }
+
+    ///////////////////////
+    /// Push part
+    ///////////////////////
+
+    void push(const T &rItem) noexcept {
+        uint64_t lSpins = 0;
+        while (isFull()) {
+            if (mExitThreadSemaphore) {
+                return;
+            }
+            mWaitStrategy.wait(mCursors[mSlowestConsumer].mReadPositionPush, mReadPositionCache, lSpins++);
+        }
+        mRingBuffer[mWritePositionPush & RING_BUFFER_SIZE].mObj = rItem;
+        BARRIER::releasePush();
+        mWritePositionPop = ++mWritePositionPush;
+        mWaitStrategy.notify(mWritePositionPop);
+    }
+
+    //Push as many items from [aFirst, aLast) as there is room for.
+    //Returns the number of items pushed (0 if the queue is full or stopped).
+    template<typename ITERATOR>
+    uint64_t pushBulk(ITERATOR aFirst, ITERATOR aLast) noexcept {
+        if (mExitThreadSemaphore) {
+            return 0;
+        }
+        uint64_t lWritePosition = mWritePositionPush;
+        uint64_t lCount = 0;
+        while (aFirst != aLast) {
+            if (lWritePosition - mReadPositionCache >= RING_BUFFER_SIZE) {
+                refreshSlowest();
+                if (lWritePosition - mReadPositionCache >= RING_BUFFER_SIZE) {
+                    break;
+                }
+            }
+            mRingBuffer[lWritePosition++ & RING_BUFFER_SIZE].mObj = *aFirst;
+            ++aFirst;
+            ++lCount;
+        }
+        if (!lCount) {
+            return 0;
+        }
+        BARRIER::releasePush();
+        mWritePositionPush = lWritePosition;
+        mWritePositionPop = lWritePosition;
+        mWaitStrategy.notify(mWritePositionPop);
+        return lCount;
+    }
+
+    //Zero-copy push. Returns a pointer to the next free slot or nullptr if the queue is full or stopped.
+    //Build the item in place and then call commitPush().
+    T *reservePush() noexcept {
+        if (isFull() || mExitThreadSemaphore) {
+            return nullptr;
+        }
+        return &mRingBuffer[mWritePositionPush & RING_BUFFER_SIZE].mObj;
+    }
+
+    void commitPush() noexcept {
+        BARRIER::releasePush();
+        mWritePositionPop = ++mWritePositionPush;
+        mWaitStrategy.notify(mWritePositionPop);
+    }
+
+    ///////////////////////
+    /// Pop part
+    ///////////////////////
+
+    FastQueueMessages tryPop(uint64_t aConsumer) {
+        Cursor &rCursor = mCursors[aConsumer];
+        if (isEmpty(rCursor)) {
+            if ((mExitThread == rCursor.mReadPositionPop) && mExitThreadSemaphore) {
+                return FastQueueMessages::END_OF_SERVICE;
+            }
+            return FastQueueMessages::NOT_READY_TO_POP;
+        }
+        return FastQueueMessages::READY_TO_POP;
+    }
+
+    //Returns a copy of the item, the item stays in the ring buffer for the other consumers
+    T pop(uint64_t aConsumer) noexcept {
+        Cursor &rCursor = mCursors[aConsumer];
+        uint64_t lSpins = 0;
+        while (isEmpty(rCursor)) {
+            if ((mExitThread == rCursor.mReadPositionPop) && mExitThreadSemaphore) {
+                return {};
+            }
+            mWaitStrategy.wait(mWritePositionPop, rCursor.mWritePositionCache, lSpins++);
+        }
+        T lData = mRingBuffer[rCursor.mReadPositionPop & RING_BUFFER_SIZE].mObj;
+        BARRIER::releasePop();
+        rCursor.mReadPositionPush = ++rCursor.mReadPositionPop;
+        mWaitStrategy.notify(rCursor.mReadPositionPush);
+        return lData;
+    }
+
+    //Copy up to aMaxCount items to aOut. Returns the number of items popped, 0 means the queue is empty,
+    //use tryPop() to see if the queue is also stopped (END_OF_SERVICE).
+    template<typename OUTPUT_ITERATOR>
+    uint64_t popBulk(uint64_t aConsumer, OUTPUT_ITERATOR aOut, uint64_t aMaxCount) noexcept {
+        Cursor &rCursor = mCursors[aConsumer];
+        uint64_t lReadPosition = rCursor.mReadPositionPop;
+        uint64_t lCount = 0;
+        while (lCount < aMaxCount) {
+            if (lReadPosition == rCursor.mWritePositionCache) {
+                rCursor.mWritePositionCache = mWritePositionPop;
+                BARRIER::acquire();
+                if (lReadPosition == rCursor.mWritePositionCache) {
+                    break;
+                }
+            }
+            *aOut = mRingBuffer[lReadPosition++ & RING_BUFFER_SIZE].mObj;
+            ++aOut;
+            ++lCount;
+        }
+        if (!lCount) {
+            return 0;
+        }
+        BARRIER::releasePop();
+        rCursor.mReadPositionPop = lReadPosition;
+        rCursor.mReadPositionPush = lReadPosition;
+        mWaitStrategy.notify(rCursor.mReadPositionPush);
+        return lCount;
+    }
+
+    //Zero-copy pop. Returns a pointer to the next item or nullptr if the queue is empty.
+    //Read the item in place (the other consumers may read it at the same time) and then call release().
+    const T *peek(uint64_t aConsumer) noexcept {
+        Cursor &rCursor = mCursors[aConsumer];
+        if (isEmpty(rCursor)) {
+            return nullptr;
+        }
+        return &mRingBuffer[rCursor.mReadPositionPop & RING_BUFFER_SIZE].mObj;
+    }
+
+    void release(uint64_t aConsumer) noexcept {
+        Cursor &rCursor = mCursors[aConsumer];
+        BARRIER::releasePop();
+        rCursor.mReadPositionPush = ++rCursor.mReadPositionPop;
+        mWaitStrategy.notify(rCursor.mReadPositionPush);
+    }
+
+    //Stop queue (Maybe called from any thread)
+    void stopQueue() {
+        mExitThread = mWritePositionPush;
+        mExitThreadSemaphore = true;
+        mWaitStrategy.notify(mWritePositionPop);
+        for (auto &rCursor: mCursors) {
+            mWaitStrategy.notify(rCursor.mReadPositionPush);
+        }
+    }
+
+    //Is the queue stopped?
+    bool isQueueStopped() {
+        return mExitThreadSemaphore;
+    }
+
+    ///Delete copy and move constructors and assign operators
+    FastQueueBroadcast(FastQueueBroadcast const &) = delete;              // Copy construct
+    FastQueueBroadcast(FastQueueBroadcast &&) = delete;                   // Move construct
+    FastQueueBroadcast &operator=(FastQueueBroadcast const &) = delete;   // Copy assign
+    FastQueueBroadcast &operator=(FastQueueBroadcast &&) = delete;        // Move assign
+private:
+    static_assert(CONSUMERS >= 1, "A FastQueueBroadcast needs at least one consumer");
+    static_assert(RING_BUFFER_SIZE != 0, "A FastQueueBroadcast must be sized at compile time");
+
+    //Read all cursors and cache the slowest one
+    inline void refreshSlowest() {
+        uint64_t lSlowest = 0;
+        uint64_t lMinPosition = mCursors[0].mReadPositionPush;
+        for (uint64_t i = 1; i < CONSUMERS; i++) {
+            uint64_t lPosition = mCursors[i].mReadPositionPush;
+            if (mWritePositionPush - lPosition > mWritePositionPush - lMinPosition) {
+                lMinPosition = lPosition;
+                lSlowest = i;
+            }
+        }
+        mReadPositionCache = lMinPosition;
+        mSlowestConsumer = lSlowest;
+        BARRIER::acquire();
+    }
+
+    //Full as seen by the producer. The cursors are only read when the cached slowest cursor says full.
+    inline bool isFull() {
+        if (mWritePositionPush - mReadPositionCache < RING_BUFFER_SIZE) {
+            return false;
+        }
+        refreshSlowest();
+        return mWritePositionPush - mReadPositionCache >= RING_BUFFER_SIZE;
+    }
+
+    //The consumer private read position and cache on one line, the published read position on the next
+    struct Cursor {
+        alignas(L1_CACHE_LNE) volatile uint64_t mReadPositionPop = 0;
+        uint64_t mWritePositionCache = 0; //Consumer local copy of mWritePositionPop
+        alignas(L1_CACHE_LNE) volatile uint64_t mReadPositionPush = 0;
+    };
+
+    //Empty as seen by one consumer
+    inline bool isEmpty(Cursor &rCursor) {
+        if (rCursor.mReadPositionPop != rCursor.mWritePositionCache) {
+            return false;
+        }
+        rCursor.mWritePositionCache = mWritePositionPop;
+        BARRIER::acquire();
+        return rCursor.mReadPositionPop == rCursor.mWritePositionCache;
+    }
+
+    using mSlot = FastQueueSlot<T, L1_CACHE_LNE, LAYOUT>;
+
+    alignas(L1_CACHE_LNE) volatile uint8_t mBorderUpp[L1_CACHE_LNE];
+    alignas(L1_CACHE_LNE) volatile uint64_t mWritePositionPush = 0;
+    uint64_t mReadPositionCache = 0; //Producer local copy of the slowest cursor
+    uint64_t mSlowestConsumer = 0;
+    alignas(L1_CACHE_LNE) volatile uint64_t mWritePositionPop = 0;
+    alignas(L1_CACHE_LNE) Cursor mCursors[CONSUMERS];
+    alignas(L1_CACHE_LNE) volatile uint64_t mExitThread = 0;
+    alignas(L1_CACHE_LNE) volatile bool mExitThreadSemaphore = false;
+    alignas(L1_CACHE_LNE) WAIT_STRATEGY mWaitStrategy;
+    alignas(L1_CACHE_LNE) mSlot mRingBuffer[RING_BUFFER_SIZE + 1];
+    alignas(L1_CACHE_LNE) volatile uint8_t mBorderDown[L1_CACHE_LNE];
+};
@@ -15,10 +15,21 @@
 #include <boost/lockfree/spsc_queue.hpp>
 #include <iostream>
 #include <thread>
+#include <vector>
+#include <algorithm>
+#include <ctime>
+#include <cmath>
+#include <iomanip>
 #include "PinToCPU.h"
+#include "PerfCounters.h"
 #include "FastQueue.h"
 #include "SPSCQueue.h"
 #include "FastQueueASM.h"
+#include "FastQueueFanIn.h"
+#include "FastQueueBroadcast.h"
+#include "FastQueueStealing.h"
+#include "FastByteQueue.h"
+#include "FastQueueRecycler.h"
 #include "spsc_queue.hpp"
 
 #define QUEUE_MASK 0b1111
@@ -28,6 +39,29 @@
 #define CONSUMER_CPU 0
 //Run the producer on CPU
 #define PRODUCER_CPU 2
+//Number of items moved per pushBulk/popBulk
+#define BULK_SIZE 64
+//Queue depth used when comparing the PADDED and DENSE FastQueue layouts
+#define DEEP_QUEUE_MASK 0xFFFFF
+//Number of items and the time between them in the wake-up latency test
+#define WAKE_LATENCY_SAMPLES 10000
+#define WAKE_LATENCY_GAP_US 100
+//Lanes in the fan-in queue, the scaling test runs 1, 2, 4 ... FAN_IN_LANES producers
+#define FAN_IN_LANES 16
+//Consumers in the broadcast (fan-out) test
+#define BROADCAST_CONSUMERS 4
+//Workers in the work-stealing test. Worker 0 gets tasks STEAL_HEAVY_FACTOR times as expensive as the others.
+#define STEAL_WORKERS 4
+#define STEAL_TASK_COST 100
+#define STEAL_HEAVY_FACTOR 20
+//Framed messages of BYTE_MESSAGE_MIN - BYTE_MESSAGE_MAX bytes through a byte ring of BYTE_QUEUE_BYTES
+#define BYTE_MESSAGE_MIN 100
+#define BYTE_MESSAGE_MAX 2048
+#define BYTE_QUEUE_BYTES 0xFFFF
+//Payload size of the buffers in the recycling test, the same as the integrity test
+#define RECYCLE_BUFFER_SIZE 1000
+//Ring of the NUMA placement test, deep enough for the ring to spread over many pages
+#define NUMA_QUEUE_MASK 0xFFFF
 
 std::atomic<uint64_t> gActiveConsumer = 0;
 std::atomic<uint64_t> gCounter = 0;
@@ -39,6 +73,86 @@ public:
     uint64_t mIndex;
 };
 
+//Trivially copyable message carried by value in the ring buffer
+struct MyMessage {
+    uint64_t mIndex;
+    uint8_t mPayload[48];
+};
+
+//Message carrying the time it was pushed
+struct MyTimedMessage {
+    uint64_t mIndex;
+    uint64_t mTimeStamp;
+};
+
+uint64_t nowNs() {
+    return std::chrono::duration_cast<std::chrono::nanoseconds>(
+            std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+//CPU time consumed by the calling thread
+uint64_t threadCpuTimeNs() {
+#ifdef _WIN64
+    FILETIME lCreation, lExit, lKernel, lUser;
+    GetThreadTimes(GetCurrentThread(), &lCreation, &lExit, &lKernel, &lUser);
+    uint64_t lKernelTime = ((uint64_t) lKernel.dwHighDateTime << 32) | lKernel.dwLowDateTime;
+    uint64_t lUserTime = ((uint64_t) lUser.dwHighDateTime << 32) | lUser.dwLowDateTime;
+    return (lKernelTime + lUserTime) * 100;
+#else
+    struct timespec lTime = {};
+    clock_gettime(CLOCK_THREAD_CPUTIME_ID, &lTime);
+    return (uint64_t) lTime.tv_sec * 1000000000 + lTime.tv_nsec;
+#endif
+}
+
+void printDelta(const std::string &rName, uint64_t aResult, uint64_t aReference) {
+    if (!aReference) {
+        std::cout << rName << " -> no reference result" << std::endl;
+        return;
+    }
+    double lDelta = ((double) aResult - (double) aReference) * 100.0 / (double) aReference;
+    std::cout << rName << " -> " << (lDelta >= 0 ? "+" : "") << lDelta << "%" << std::endl;
+}
+
+//aPercentile 0.0 - 1.0, rValues must be sorted
+uint64_t percentile(const std::vector<uint64_t> &rValues, double aPercentile) {
+    if (rValues.empty()) {
+        return 0;
+    }
+    auto lIndex = (size_t) (aPercentile * (double) (rValues.size() - 1));
+    return rValues[lIndex];
+}
+
+//Both threads pin and wait for the start, if either pin failed neither touches the queues
+struct PinStart {
+    std::atomic<uint64_t> mPinned = 0;
+    std::atomic<bool> mPinFail = false;
+    std::atomic<bool> mStart = false;
+
+    //Called by the threads, returns false if the test is off
+    bool ready(int32_t aCPU) {
+        if (!pinThread(aCPU)) {
+            mPinFail = true;
+        }
+        mPinned++;
+        while (!mStart) {
+            fastQueueCpuRelax();
+        }
+        return !mPinFail;
+    }
+
+    //Called by the main thread, returns false if a pin failed
+    bool go() {
+        while (mPinned != 2) {
+            std::this_thread::sleep_for(std::chrono::milliseconds(1));
+        }
+        // Wait for the OS to actually get it done.
+        std::this_thread::sleep_for(std::chrono::milliseconds(10));
+        mStart = true;
+        return !mPinFail;
+    }
+};
+
 /// -----------------------------------------------------------
 ///
 /// Boost queue section Start
@@ -101,7 +215,8 @@ void boostLockFreeConsumer(boost::lockfree::spsc_queue<MyObject *, boost::lockfr
 ///
 /// -----------------------------------------------------------
 
-void fastQueueProducer(FastQueue<MyObject *, QUEUE_MASK, L1_CACHE_LINE> *pQueue, int32_t aCPU) {
+template<typename QUEUE>
+void fastQueueProducer(QUEUE *pQueue, int32_t aCPU) {
     if (!pinThread(aCPU)) {
         std::cout << "Pin CPU fail. " << std::endl;
         return;
@@ -122,7 +237,8 @@ void fastQueueProducer(FastQueue<MyObject *, QUEUE_MASK, L1_CACHE_LINE> *pQueue,
     pQueue->stopQueue();
 }
 
-void fastQueueConsumer(FastQueue<MyObject *, QUEUE_MASK, L1_CACHE_LINE> *pQueue, int32_t aCPU) {
+template<typename QUEUE>
+void fastQueueConsumer(QUEUE *pQueue, int32_t aCPU) {
     if (!pinThread(aCPU)) {
         std::cout << "Pin CPU fail. " << std::endl;
         gActiveConsumer--;
@@ -214,7 +330,9 @@ void rigtorpQueueConsumer(rigtorp::SPSCQueue<MyObject *> *pQueue, int32_t aCPU)
 ///
 /// -----------------------------------------------------------
 
-void fastQueueASMProducer(FastQueueASM::DataBlock *pQueue, int32_t aCPU) {
+//pPush / pPop select the kernel, the dmb based push_item / pop_item by default
+void fastQueueASMProducer(FastQueueASM::DataBlock *pQueue, int32_t aCPU,
+                          FastQueueASM::PushFunction pPush = FastQueueASM::push_item) {
     if (!pinThread(aCPU)) {
         std::cout << "Pin CPU fail. " << std::endl;
         return;
@@ -230,12 +348,13 @@ void fastQueueASMProducer(FastQueueASM::DataBlock *pQueue, int32_t aCPU) {
     while (gActiveProducer) {
         auto lTheObject = new MyObject();
         lTheObject->mIndex = lCounter++;
-        FastQueueASM::push_item(pQueue, lTheObject);
+        pPush(pQueue, lTheObject);
     }
     stopQueue(pQueue);
 }
 
-void fastQueueASMConsumer(FastQueueASM::DataBlock *pQueue, int32_t aCPU) {
+void fastQueueASMConsumer(FastQueueASM::DataBlock *pQueue, int32_t aCPU,
+                          FastQueueASM::PopFunction pPop = FastQueueASM::pop_item) {
     if (!pinThread(aCPU)) {
         std::cout << "Pin CPU fail. " << std::endl;
         gActiveConsumer--;
@@ -243,7 +362,7 @@ void fastQueueASMConsumer(FastQueueASM::DataBlock *pQueue, int32_t aCPU) {
     }
     uint64_t lCounter = 0;
     while (true) {
-        auto lResult = (MyObject *) FastQueueASM::pop_item(pQueue);
+        auto lResult = (MyObject *) pPop(pQueue);
         if (lResult == nullptr) {
             break;
         }
@@ -257,6 +376,126 @@ void fastQueueASMConsumer(FastQueueASM::DataBlock *pQueue, int32_t aCPU) {
     gActiveConsumer--;
 }
 
+//Poll loop, try_push_item / try_pop_item
+void fastQueueASMProducerTry(FastQueueASM::DataBlock *pQueue, int32_t aCPU) {
+    if (!pinThread(aCPU)) {
+        std::cout << "Pin CPU fail. " << std::endl;
+        return;
+    }
+    while (!gStartBench) {
+#ifdef _MSC_VER
+        __nop();
+#else
+        asm volatile ("NOP");
+#endif
+    }
+    uint64_t lCounter = 0;
+    while (gActiveProducer) {
+        auto lTheObject = new MyObject();
+        lTheObject->mIndex = lCounter++;
+        while (!FastQueueASM::try_push_item(pQueue, lTheObject)) {
+            if (!gActiveProducer) {
+                delete lTheObject;
+                break;
+            }
+        }
+    }
+    stopQueue(pQueue);
+}
+
+void fastQueueASMConsumerTry(FastQueueASM::DataBlock *pQueue, int32_t aCPU) {
+    if (!pinThread(aCPU)) {
+        std::cout << "Pin CPU fail. " << std::endl;
+        gActiveConsumer--;
+        return;
+    }
+    uint64_t lCounter = 0;
+    while (true) {
+        void *pResult = nullptr;
+        uint64_t lStatus = FastQueueASM::try_pop_item(pQueue, &pResult);
+        if (lStatus == FastQueueASM::END_OF_SERVICE) {
+            break;
+        }
+        if (lStatus == FastQueueASM::NOT_READY_TO_POP) {
+            continue;
+        }
+        auto lResult = (MyObject *) pResult;
+        if (lResult->mIndex != lCounter) {
+            std::cout << "Queue item error " << lResult->mIndex << " " << lCounter << std::endl;
+        }
+        delete lResult;
+        lCounter++;
+    }
+    gCounter += lCounter;
+    gActiveConsumer--;
+}
+
+//Bursts, push_items / pop_items
+void fastQueueASMProducerBulk(FastQueueASM::DataBlock *pQueue, int32_t aCPU) {
+    if (!pinThread(aCPU)) {
+        std::cout << "Pin CPU fail. " << std::endl;
+        return;
+    }
+    while (!gStartBench) {
+#ifdef _MSC_VER
+        __nop();
+#else
+        asm volatile ("NOP");
+#endif
+    }
+    uint64_t lCounter = 0;
+    void *lBatch[BULK_SIZE];
+    while (gActiveProducer) {
+        for (auto &rObject: lBatch) {
+            auto lTheObject = new MyObject();
+            lTheObject->mIndex = lCounter++;
+            rObject = lTheObject;
+        }
+        uint64_t lPushed = 0;
+        while (lPushed != BULK_SIZE) {
+            lPushed += FastQueueASM::push_items(pQueue, lBatch + lPushed, BULK_SIZE - lPushed);
+            if (!gActiveProducer && lPushed != BULK_SIZE) {
+                //The consumer will stop at the last pushed item, garbage collect the rest
+                while (lPushed != BULK_SIZE) {
+                    delete (MyObject *) lBatch[lPushed++];
+                }
+            }
+        }
+    }
+    stopQueue(pQueue);
+}
+
+void fastQueueASMConsumerBulk(FastQueueASM::DataBlock *pQueue, int32_t aCPU) {
+    if (!pinThread(aCPU)) {
+        std::cout << "Pin CPU fail. " << std::endl;
+        gActiveConsumer--;
+        return;
+    }
+    uint64_t lCounter = 0;
+    void *lBatch[BULK_SIZE];
+    while (true) {
+        uint64_t lPopped = FastQueueASM::pop_items(pQueue, lBatch, BULK_SIZE);
+        if (!lPopped) {
+            //Picks up a single item if one arrived after pop_items looked
+            uint64_t lStatus = FastQueueASM::try_pop_item(pQueue, lBatch);
+            if (lStatus == FastQueueASM::END_OF_SERVICE) {
+                break;
+            }
+            lPopped = lStatus == FastQueueASM::ITEM_POPPED ? 1 : 0;
+        }
+        for (uint64_t i = 0; i < lPopped; i++) {
+            auto lResult = (MyObject *) lBatch[i];
+            if (lResult->mIndex != lCounter) {
+                std::cout << "Queue item error " << lResult->mIndex << " " << lCounter << std::endl;
+            }
+            delete lResult;
+            lCounter++;
+        }
+    }
+    gCounter += lCounter;
+    gActiveConsumer--;
+}
+
 
 /// -----------------------------------------------------------
 ///
@@ -385,74 +624,2518 @@ void fastQueueConsumerRaw(FastQueue<MyObject *, QUEUE_MASK, L1_CACHE_LINE> *pQue
 ///
 /// -----------------------------------------------------------
 
+/// -----------------------------------------------------------
+///
+/// FastQueueBulk section Start
+///
+/// -----------------------------------------------------------
 
-int main() {
-
-    ///
-    /// BoostLockfree test ->
-    ///
+void fastQueueProducerBulk(FastQueue<MyObject *, QUEUE_MASK, L1_CACHE_LINE> *pQueue, int32_t aCPU) {
+    if (!pinThread(aCPU)) {
+        std::cout << "Pin CPU fail. " << std::endl;
+        return;
+    }
+    while (!gStartBench) {
+#ifdef _MSC_VER
+        __nop();
+#else
+        asm volatile ("NOP");
+#endif
+    }
+    uint64_t lCounter = 0;
+    MyObject *lBatch[BULK_SIZE];
+    while (gActiveProducer) {
+        for (auto &rObject: lBatch) {
+            rObject = new MyObject();
+            rObject->mIndex = lCounter++;
+        }
+        MyObject **lpFirst = lBatch;
+        MyObject **lpLast = lBatch + BULK_SIZE;
+        while (lpFirst != lpLast) {
+            lpFirst += pQueue->pushBulk(lpFirst, lpLast);
+            if (!gActiveProducer && lpFirst != lpLast) {
+                //The consumer will stop at the last pushed item, garbage collect the rest
+                while (lpFirst != lpLast) {
+                    delete *lpFirst++;
+                }
+            }
+        }
+    }
+    pQueue->stopQueue();
+}
 
-    // Create the queue
-    auto lBoostLockFree = new boost::lockfree::spsc_queue<MyObject *, boost::lockfree::capacity<QUEUE_MASK>>;
+void fastQueueConsumerBulk(FastQueue<MyObject *, QUEUE_MASK, L1_CACHE_LINE> *pQueue, int32_t aCPU) {
+    if (!pinThread(aCPU)) {
+        std::cout << "Pin CPU fail. " << std::endl;
+        gActiveConsumer--;
+        return;
+    }
+    uint64_t lCounter = 0;
+    MyObject *lBatch[BULK_SIZE];
+    while (true) {
+        uint64_t lPopped = pQueue->popBulk(lBatch, BULK_SIZE);
+        if (!lPopped) {
+            if (pQueue->tryPop() == FastQueue<MyObject *, QUEUE_MASK, L1_CACHE_LINE>::FastQueueMessages::END_OF_SERVICE) {
+                break;
+            }
+            continue;
+        }
+        for (uint64_t i = 0; i < lPopped; i++) {
+            if (lBatch[i]->mIndex != lCounter) {
+                std::cout << "Queue item error" << std::endl;
+            }
+            lCounter++;
+            delete lBatch[i];
+        }
+    }
+    gCounter += lCounter;
+    gActiveConsumer--;
+}
 
-    // Start the consumer(s) / Producer(s)
-    gActiveConsumer++;
-    std::thread([lBoostLockFree] { return boostLockFreeConsumer(lBoostLockFree, CONSUMER_CPU); }).detach();
-    std::thread([lBoostLockFree] { return boostLockFreeProducer(lBoostLockFree, PRODUCER_CPU); }).detach();
+/// -----------------------------------------------------------
+///
+/// FastQueueBulk section End
+///
+/// -----------------------------------------------------------
 
-    // Wait for the OS to actually get it done.
-    std::this_thread::sleep_for(std::chrono::milliseconds(10));
+/// -----------------------------------------------------------
+///
+/// FastQueueMessage section Start
+///
+/// -----------------------------------------------------------
 
-    // Start the test
-    std::cout << "BoostLockFree pointer test started." << std::endl;
-    gStartBench = true;
-    std::this_thread::sleep_for(std::chrono::seconds(TEST_TIME_DURATION_SEC));
+//Messages pushed by value, copied into and out of the ring buffer
+void fastQueueProducerMessage(FastQueue<MyMessage, QUEUE_MASK, L1_CACHE_LINE> *pQueue, int32_t aCPU) {
+    if (!pinThread(aCPU)) {
+        std::cout << "Pin CPU fail. " << std::endl;
+        return;
+    }
+    while (!gStartBench) {
+#ifdef _MSC_VER
+        __nop();
+#else
+        asm volatile ("NOP");
+#endif
+    }
+    uint64_t lCounter = 0;
+    MyMessage lMessage = {};
+    while (gActiveProducer) {
+        lMessage.mIndex = lCounter++;
+        lMessage.mPayload[0] = (uint8_t) lMessage.mIndex;
+        pQueue->push(lMessage);
+    }
+    pQueue->stopQueue();
+}
 
-    // End the test
-    gActiveProducer = false;
-    std::cout << "BoostLockFree pointer test ended." << std::endl;
+void fastQueueConsumerMessage(FastQueue<MyMessage, QUEUE_MASK, L1_CACHE_LINE> *pQueue, int32_t aCPU) {
+    if (!pinThread(aCPU)) {
+        std::cout << "Pin CPU fail. " << std::endl;
+        gActiveConsumer--;
+        return;
+    }
+    uint64_t lCounter = 0;
+    while (true) {
+        auto lState = pQueue->tryPop();
+        if (lState == FastQueue<MyMessage, QUEUE_MASK, L1_CACHE_LINE>::FastQueueMessages::END_OF_SERVICE) {
+            break;
+        }
+        if (lState != FastQueue<MyMessage, QUEUE_MASK, L1_CACHE_LINE>::FastQueueMessages::READY_TO_POP) {
+            continue;
+        }
+        MyMessage lMessage = pQueue->popAfterTry();
+        if (lMessage.mIndex != lCounter || lMessage.mPayload[0] != (uint8_t) lCounter) {
+            std::cout << "Queue item error" << std::endl;
+        }
+        lCounter++;
+    }
+    gCounter += lCounter;
+    gActiveConsumer--;
+}
 
-    // Wait for the consumers to 'join'
-    // Why not the classic join? I prepared for a multi thread case I need this function for.
-    while (gActiveConsumer) {
-        std::this_thread::sleep_for(std::chrono::milliseconds(1));
+//Messages built and read in place in the ring buffer
+void fastQueueProducerInPlace(FastQueue<MyMessage, QUEUE_MASK, L1_CACHE_LINE> *pQueue, int32_t aCPU) {
+    if (!pinThread(aCPU)) {
+        std::cout << "Pin CPU fail. " << std::endl;
+        return;
+    }
+    while (!gStartBench) {
+#ifdef _MSC_VER
+        __nop();
+#else
+        asm volatile ("NOP");
+#endif
+    }
+    uint64_t lCounter = 0;
+    while (gActiveProducer) {
+        MyMessage *lpMessage = pQueue->reservePush();
+        if (!lpMessage) {
+            continue;
+        }
+        lpMessage->mIndex = lCounter;
+        lpMessage->mPayload[0] = (uint8_t) lCounter++;
+        pQueue->commitPush();
     }
+    pQueue->stopQueue();
+}
 
-    // Garbage collect the queue
-    delete lBoostLockFree;
+void fastQueueConsumerInPlace(FastQueue<MyMessage, QUEUE_MASK, L1_CACHE_LINE> *pQueue, int32_t aCPU) {
+    if (!pinThread(aCPU)) {
+        std::cout << "Pin CPU fail. " << std::endl;
+        gActiveConsumer--;
+        return;
+    }
+    uint64_t lCounter = 0;
+    while (true) {
+        const MyMessage *lpMessage = pQueue->peek();
+        if (!lpMessage) {
+            if (pQueue->tryPop() == FastQueue<MyMessage, QUEUE_MASK, L1_CACHE_LINE>::FastQueueMessages::END_OF_SERVICE) {
+                break;
+            }
+            continue;
+        }
+        if (lpMessage->mIndex != lCounter || lpMessage->mPayload[0] != (uint8_t) lCounter) {
+            std::cout << "Queue item error" << std::endl;
+        }
+        pQueue->release();
+        lCounter++;
+    }
+    gCounter += lCounter;
+    gActiveConsumer--;
+}
 
-    // Print the result.
-    std::cout << "BoostLockFree Transactions -> " << gCounter / TEST_TIME_DURATION_SEC << "/s" << std::endl;
+/// -----------------------------------------------------------
+///
+/// FastQueueMessage section End
+///
+/// -----------------------------------------------------------
 
-    // Zero the test parameters.
-    gStartBench = false;
-    gActiveProducer = true;
-    gCounter = 0;
-    gActiveConsumer = 0;
 
-    ///
+/// -----------------------------------------------------------
+///
+/// Barrier ablation section Start
+///
+/// -----------------------------------------------------------
+
+//Runs the FastQueue pointer test with the given barrier policy and prints the cost per item.
+//The cost is given in ns and in core cycles counted by the producer and the consumer thread (PerfCounters),
+//the cycles are n/a where the counters are not available. Nothing is allocated while measuring, the
+//pointers pushed are the item index + 1 and never dereferenced.
+template<typename QUEUE>
+void barrierAblationTest(const std::string &rName) {
+    auto lQueue = new QUEUE();
+    PinStart lStart;
+    std::atomic<bool> lActive = true;
+    uint64_t lCounter = 0;
+    PerfCounters lProducerCounters;
+    PerfCounters lConsumerCounters;
+
+    std::thread lConsumer([&] {
+        if (!lStart.ready(CONSUMER_CPU)) {
+            return;
+        }
+        lConsumerCounters.open();
+        lConsumerCounters.start();
+        while (true) {
+            auto lResult = lQueue->pop();
+            if (lResult == nullptr) {
+                break;
+            }
+            if ((uint64_t) lResult != ++lCounter) {
+                std::cout << "Queue item error" << std::endl;
+            }
+        }
+        lConsumerCounters.stop();
+    });
+    std::thread lProducer([&] {
+        if (!lStart.ready(PRODUCER_CPU)) {
+            return;
+        }
+        lProducerCounters.open();
+        lProducerCounters.start();
+        uint64_t lIndex = 0;
+        while (lActive.load(std::memory_order_relaxed)) {
+            auto lTheObject = (MyObject *) ++lIndex;
+            lQueue->push(lTheObject);
+        }
+        lProducerCounters.stop();
+        lQueue->stopQueue();
+    });
+
+    std::cout << rName << " barrier test started." << std::endl;
+    bool lPinned = lStart.go();
+    uint64_t lTimeStart = nowNs();
+    if (lPinned) {
+        std::this_thread::sleep_for(std::chrono::seconds(TEST_TIME_DURATION_SEC));
+        lActive = false;
+    }
+    lConsumer.join();
+    lProducer.join();
+    uint64_t lTimeNs = nowNs() - lTimeStart;
+    delete lQueue;
+    std::cout << rName << " barrier test ended." << std::endl;
+    if (!lPinned) {
+        std::cout << "Pin CPU fail. " << std::endl;
+        return;
+    }
+
+    uint64_t lItems = lCounter ? lCounter : 1;
+    std::cout << rName << " Transactions -> " << lCounter / TEST_TIME_DURATION_SEC << "/s "
+              << (double) lTimeNs / (double) lItems << " ns/op";
+    for (auto lCounters: {&lProducerCounters, &lConsumerCounters}) {
+        std::cout << (lCounters == &lProducerCounters ? " producer " : " consumer ");
+        if (lCounters->available(PerfCounters::CYCLES)) {
+            std::cout << (double) lCounters->value(PerfCounters::CYCLES) / (double) lItems << " cycles/op";
+        } else {
+            std::cout << "n/a cycles/op";
+        }
+    }
+    std::cout << std::endl;
+}
+
+/// -----------------------------------------------------------
+///
+/// Barrier ablation section End
+///
+/// -----------------------------------------------------------
+
+/// -----------------------------------------------------------
+///
+/// Stats section Start
+///
+/// -----------------------------------------------------------
+
+//Runs the FastQueue pointer test with the FastQueueStats instrumentation and prints the counters
+void statsTest() {
+    using StatsQueue = FastQueue<MyObject *, QUEUE_MASK, L1_CACHE_LINE, FastQueueLayout::PADDED, FastQueueWaitBusy,
+            FastQueueBarrierFence, FastQueueStats>;
+    gStartBench = false;
+    gActiveProducer = true;
+    gCounter = 0;
+    gActiveConsumer = 0;
+
+    auto lQueue = new StatsQueue();
+    gActiveConsumer++;
+    std::thread([lQueue] { return fastQueueConsumer(lQueue, CONSUMER_CPU); }).detach();
+    std::thread([lQueue] { return fastQueueProducer(lQueue, PRODUCER_CPU); }).detach();
+    std::this_thread::sleep_for(std::chrono::milliseconds(10));
+
+    std::cout << "FastQueueStats test started." << std::endl;
+    gStartBench = true;
+    std::this_thread::sleep_for(std::chrono::seconds(TEST_TIME_DURATION_SEC));
+    gActiveProducer = false;
+    std::cout << "FastQueueStats test ended." << std::endl;
+    while (gActiveConsumer) {
+        std::this_thread::sleep_for(std::chrono::milliseconds(1));
+    }
+
+    auto &rProducer = lQueue->producerStats();
+    auto &rConsumer = lQueue->consumerStats();
+    std::cout << "FastQueueStats Transactions -> " << gCounter / TEST_TIME_DURATION_SEC << "/s" << std::endl;
+    std::cout << "FastQueueStats pushes " << rProducer.mPushes << " full spins " << rProducer.mFullSpins
+              << " pops " << rConsumer.mPops << " empty spins " << rConsumer.mEmptySpins << " max occupancy "
+              << rProducer.mMaxOccupancy << "/" << QUEUE_MASK << std::endl;
+    std::cout << "FastQueueStats occupancy histogram ->";
+    for (uint64_t i = 0; i < 64 && (1ULL << i) <= QUEUE_MASK; i++) {
+        std::cout << " " << (1ULL << i) << "+:" << rProducer.mOccupancyHistogram[i];
+    }
+    std::cout << std::endl;
+    delete lQueue;
+}
+
+//Runs the FastQueue pointer test with sampled time in queue and prints the percentiles
+void latencyStatsTest() {
+    using LatencyQueue = FastQueue<MyObject *, QUEUE_MASK, L1_CACHE_LINE, FastQueueLayout::PADDED, FastQueueWaitBusy,
+            FastQueueBarrierFence, FastQueueLatencyStats<>>;
+    gStartBench = false;
+    gActiveProducer = true;
+    gCounter = 0;
+    gActiveConsumer = 0;
+
+    //Calibrate the timestamps before the test
+    fastQueueNsPerTick();
+    auto lQueue = new LatencyQueue();
+    gActiveConsumer++;
+    std::thread([lQueue] { return fastQueueConsumer(lQueue, CONSUMER_CPU); }).detach();
+    std::thread([lQueue] { return fastQueueProducer(lQueue, PRODUCER_CPU); }).detach();
+    std::this_thread::sleep_for(std::chrono::milliseconds(10));
+
+    std::cout << "FastQueueLatencyStats test started." << std::endl;
+    gStartBench = true;
+    std::this_thread::sleep_for(std::chrono::seconds(TEST_TIME_DURATION_SEC));
+    gActiveProducer = false;
+    std::cout << "FastQueueLatencyStats test ended." << std::endl;
+    while (gActiveConsumer) {
+        std::this_thread::sleep_for(std::chrono::milliseconds(1));
+    }
+
+    auto &rConsumer = lQueue->consumerStats();
+    std::cout << "FastQueueLatencyStats Transactions -> " << gCounter / TEST_TIME_DURATION_SEC << "/s" << std::endl;
+    std::cout << "FastQueueLatencyStats time in queue (" << rConsumer.samples() << " samples) -> p50 "
+              << rConsumer.percentileNs(0.5) << "ns p99 " << rConsumer.percentileNs(0.99) << "ns p99.9 "
+              << rConsumer.percentileNs(0.999) << "ns max " << rConsumer.maxNs() << "ns" << std::endl;
+    delete lQueue;
+}
+
+/// -----------------------------------------------------------
+///
+/// Stats section End
+///
+/// -----------------------------------------------------------
+
+/// -----------------------------------------------------------
+///
+/// NUMA section Start
+///
+/// -----------------------------------------------------------
+
+template<typename QUEUE>
+void numaProducer(QUEUE *pQueue, int32_t aCPU) {
+    if (!pinThread(aCPU)) {
+        std::cout << "Pin CPU fail. " << std::endl;
+        return;
+    }
+    while (!gStartBench) {
+#ifdef _MSC_VER
+        __nop();
+#else
+        asm volatile ("NOP");
+#endif
+    }
+    uint64_t lCounter = 0;
+    MyMessage lMessage = {};
+    while (gActiveProducer) {
+        lMessage.mIndex = lCounter++;
+        pQueue->push(lMessage);
+    }
+    pQueue->stopQueue();
+}
+
+template<typename QUEUE>
+void numaConsumer(QUEUE *pQueue, int32_t aCPU) {
+    if (!pinThread(aCPU)) {
+        std::cout << "Pin CPU fail. " << std::endl;
+        gActiveConsumer--;
+        return;
+    }
+    uint64_t lCounter = 0;
+    while (true) {
+        auto lResult = pQueue->tryPop();
+        if (lResult == QUEUE::FastQueueMessages::END_OF_SERVICE) {
+            break;
+        }
+        if (lResult != QUEUE::FastQueueMessages::READY_TO_POP) {
+            continue;
+        }
+        auto lMessage = pQueue->popAfterTry();
+        if (lMessage.mIndex != lCounter) {
+            std::cout << "Queue item error" << std::endl;
+        }
+        lCounter++;
+    }
+    gCounter += lCounter;
+    gActiveConsumer--;
+}
+
+//Runs a FastQueue of messages between the two CPUs with the queue placed as in rNuma
+uint64_t numaPlacementRun(const std::string &rName, const FastQueueNuma &rNuma, int32_t aConsumerCPU,
+                          int32_t aProducerCPU) {
+    using NumaQueue = FastQueue<MyMessage, 0, L1_CACHE_LINE>;
+    gStartBench = false;
+    gActiveProducer = true;
+    gCounter = 0;
+    gActiveConsumer = 0;
+
+    NumaQueue *lQueue;
+    try {
+        lQueue = fastQueueNewOnNodes<NumaQueue>(rNuma, NUMA_QUEUE_MASK);
+    } catch (const std::exception &rError) {
+        std::cout << "FastQueue NUMA " << rName << " -> " << rError.what() << std::endl;
+        return 0;
+    }
+    gActiveConsumer++;
+    std::thread([lQueue, aConsumerCPU] { return numaConsumer(lQueue, aConsumerCPU); }).detach();
+    std::thread([lQueue, aProducerCPU] { return numaProducer(lQueue, aProducerCPU); }).detach();
+    std::this_thread::sleep_for(std::chrono::milliseconds(10));
+
+    std::cout << "FastQueue NUMA " << rName << " test started." << std::endl;
+    gStartBench = true;
+    std::this_thread::sleep_for(std::chrono::seconds(TEST_TIME_DURATION_SEC));
+    gActiveProducer = false;
+    std::cout << "FastQueue NUMA " << rName << " test ended." << std::endl;
+    while (gActiveConsumer) {
+        std::this_thread::sleep_for(std::chrono::milliseconds(1));
+    }
+    fastQueueDeleteOnNodes(lQueue);
+
+    std::cout << "FastQueue NUMA " << rName << " Transactions -> " << gCounter / TEST_TIME_DURATION_SEC << "/s"
+              << std::endl;
+    return gCounter / TEST_TIME_DURATION_SEC;
+}
+
+//Cross-socket pair with the ring and the control lines on the producer node, on the consumer node and split
+//(each sides lines on its own node, the ring with the consumer). A pair on one node is the reference.
+void numaPlacementTest() {
+    auto lTopology = cpuTopology();
+    int32_t lConsumerCPU, lProducerCPU;
+    if (!pickCpuPair(lTopology, CpuSharing::CROSS_NODE, lConsumerCPU, lProducerCPU)) {
+        std::cout << "FastQueue NUMA test needs CPUs on two NUMA nodes, skipped." << std::endl;
+        return;
+    }
+    int32_t lConsumerNode = cpuNumaNode(lConsumerCPU);
+    int32_t lProducerNode = cpuNumaNode(lProducerCPU);
+    std::cout << "FastQueue NUMA consumer CPU " << lConsumerCPU << " (node " << lConsumerNode << ") producer CPU "
+              << lProducerCPU << " (node " << lProducerNode << ")" << std::endl;
+
+    int32_t lLocalConsumerCPU, lLocalProducerCPU;
+    if (pickCpuPair(lTopology, CpuSharing::NUMA_NODE, lLocalConsumerCPU, lLocalProducerCPU)) {
+        int32_t lNode = cpuNumaNode(lLocalConsumerCPU);
+        numaPlacementRun("same node pair", {lNode, lNode, lNode}, lLocalConsumerCPU, lLocalProducerCPU);
+    }
+    uint64_t lProducerResult = numaPlacementRun("producer node", {lProducerNode, lProducerNode, lProducerNode},
+                                                lConsumerCPU, lProducerCPU);
+    uint64_t lConsumerResult = numaPlacementRun("consumer node", {lConsumerNode, lConsumerNode, lConsumerNode},
+                                                lConsumerCPU, lProducerCPU);
+    uint64_t lSplitResult = numaPlacementRun("split", {lConsumerNode, lProducerNode, lConsumerNode},
+                                             lConsumerCPU, lProducerCPU);
+    printDelta("FastQueue NUMA consumer node vs. producer node", lConsumerResult, lProducerResult);
+    printDelta("FastQueue NUMA split vs. producer node", lSplitResult, lProducerResult);
+}
+
+/// -----------------------------------------------------------
+///
+/// NUMA section End
+///
+/// -----------------------------------------------------------
+
+/// -----------------------------------------------------------
+///
+/// Wake-up latency section Start
+///
+/// -----------------------------------------------------------
+
+//The producer pushes one item every WAKE_LATENCY_GAP_US so the consumer always waits on an empty queue.
+//Measures the time from push to the consumer having the item and how much CPU the waiting consumer burns.
+//A thread waiting in UMWAIT / wfe is still running as far as the OS is concerned, the instructions the
+//consumer retires per item (perf counters, if available) shows how hard it polls.
+template<typename QUEUE>
+void wakeLatencyTest(const std::string &rName) {
+    auto lQueue = new QUEUE();
+    std::vector<uint64_t> lLatencies;
+    lLatencies.reserve(WAKE_LATENCY_SAMPLES);
+    uint64_t lConsumerCpuNs = 0;
+    uint64_t lConsumerWallNs = 0;
+    PerfCounters lCounters;
+
+    std::cout << rName << " wake-up latency test started." << std::endl;
+    PinStart lStart;
+    std::thread lConsumer([&] {
+        if (!lStart.ready(CONSUMER_CPU)) {
+            return;
+        }
+        lCounters.open();
+        lCounters.start();
+        uint64_t lCpuStart = threadCpuTimeNs();
+        uint64_t lWallStart = nowNs();
+        while (true) {
+            MyTimedMessage lMessage = lQueue->pop();
+            uint64_t lNow = nowNs();
+            if (!lMessage.mIndex) {
+                break;
+            }
+            lLatencies.push_back(lNow - lMessage.mTimeStamp);
+        }
+        lConsumerCpuNs = threadCpuTimeNs() - lCpuStart;
+        lConsumerWallNs = nowNs() - lWallStart;
+        lCounters.stop();
+    });
+    std::thread lProducer([&] {
+        if (!lStart.ready(PRODUCER_CPU)) {
+            return;
+        }
+        for (uint64_t i = 1; i <= WAKE_LATENCY_SAMPLES; i++) {
+            std::this_thread::sleep_for(std::chrono::microseconds(WAKE_LATENCY_GAP_US));
+            MyTimedMessage lMessage = {i, nowNs()};
+            lQueue->push(lMessage);
+        }
+        lQueue->stopQueue();
+    });
+    bool lPinned = lStart.go();
+    lProducer.join();
+    lConsumer.join();
+    delete lQueue;
+    if (!lPinned) {
+        std::cout << "Pin CPU fail. " << std::endl;
+        return;
+    }
+
+    std::sort(lLatencies.begin(), lLatencies.end());
+    std::cout << rName << " wake-up latency test ended." << std::endl;
+    std::cout << rName << " wake-up latency -> p50 " << percentile(lLatencies, 0.5) << "ns p99 "
+              << percentile(lLatencies, 0.99) << "ns max " << percentile(lLatencies, 1.0) << "ns consumer CPU "
+              << (lConsumerWallNs ? lConsumerCpuNs * 100 / lConsumerWallNs : 0) << "%";
+    if (lCounters.available(PerfCounters::INSTRUCTIONS) && !lLatencies.empty()) {
+        std::cout << " instructions/item " << lCounters.value(PerfCounters::INSTRUCTIONS) / lLatencies.size();
+    }
+    std::cout << std::endl;
+}
+
+//FastQueueASM with the push / pop / stopQueue interface wakeLatencyTest uses. The messages are kept in a table
+//and the pointer to the entry is what is pushed, nothing is allocated while measuring.
+//WAIT pops with FastQueueASM::popItemWait() (UMWAIT / pause / wfe) instead of the polling pop_item.
+template<bool WAIT>
+class WakeLatencyASM {
+public:
+    WakeLatencyASM() : mMessages(WAKE_LATENCY_SAMPLES + 1),
+                       mPop(WAIT ? FastQueueASM::popItemWait() : FastQueueASM::pop_item),
+                       mQueue(FastQueueASM::newQueue(QUEUE_MASK)) {}
+
+    ~WakeLatencyASM() {
+        FastQueueASM::deleteQueue(mQueue);
+    }
+
+    void push(MyTimedMessage &rMessage) {
+        mMessages[rMessage.mIndex] = rMessage;
+        FastQueueASM::push_item(mQueue, &mMessages[rMessage.mIndex]);
+    }
+
+    MyTimedMessage pop() {
+        auto pMessage = (MyTimedMessage *) mPop(mQueue);
+        return pMessage ? *pMessage : MyTimedMessage{};
+    }
+
+    void stopQueue() {
+        FastQueueASM::stopQueue(mQueue);
+    }
+
+private:
+    std::vector<MyTimedMessage> mMessages;
+    FastQueueASM::PopFunction mPop;
+    FastQueueASM::DataBlock *mQueue;
+};
+
+/// -----------------------------------------------------------
+///
+/// Wake-up latency section End
+///
+/// -----------------------------------------------------------
+
+/// -----------------------------------------------------------
+///
+/// FanInQueue section Start
+///
+/// -----------------------------------------------------------
+
+using FanIn = FanInQueue<MyObject *, FAN_IN_LANES, QUEUE_MASK, L1_CACHE_LINE>;
+
+//The producers stamp their lane in the upper 16 bits of the index so the consumer can check the order per lane
+void fanInProducer(FanIn *pQueue, int32_t aCPU) {
+    //Producers beyond the available CPUs run unpinned
+    if (aCPU >= 0 && !pinThread(aCPU)) {
+        std::cout << "Pin CPU fail. " << std::endl;
+        return;
+    }
+    uint64_t lLane = pQueue->registerProducer();
+    while (!gStartBench) {
+#ifdef _MSC_VER
+        __nop();
+#else
+        asm volatile ("NOP");
+#endif
+    }
+    uint64_t lCounter = 0;
+    while (gActiveProducer) {
+        auto lTheObject = new MyObject();
+        lTheObject->mIndex = (lLane << 48) | lCounter++;
+        pQueue->push(lLane, lTheObject);
+    }
+}
+
+void fanInConsumer(FanIn *pQueue, int32_t aCPU) {
+    if (!pinThread(aCPU)) {
+        std::cout << "Pin CPU fail. " << std::endl;
+        gActiveConsumer--;
+        return;
+    }
+    std::vector<uint64_t> lExpected(FAN_IN_LANES, 0);
+    MyObject *lResults[BULK_SIZE];
+    uint64_t lCounter = 0;
+    while (true) {
+        uint64_t lCount = pQueue->popBulk(lResults, BULK_SIZE);
+        if (!lCount) {
+            if (pQueue->isQueueStopped() && pQueue->isDrained()) {
+                break;
+            }
+            continue;
+        }
+        for (uint64_t i = 0; i < lCount; i++) {
+            uint64_t lLane = lResults[i]->mIndex >> 48;
+            if ((lResults[i]->mIndex & 0xFFFFFFFFFFFF) != lExpected[lLane]++) {
+                std::cout << "Queue item error" << std::endl;
+            }
+            delete lResults[i];
+        }
+        lCounter += lCount;
+    }
+    gCounter += lCounter;
+    gActiveConsumer--;
+}
+
+//One consumer draining aProducers producers
+void fanInScalingTest(uint64_t aProducers) {
+    gStartBench = false;
+    gActiveProducer = true;
+    gCounter = 0;
+    gActiveConsumer = 0;
+
+    auto lQueue = new FanIn();
+    int32_t lCPUs = (int32_t) std::thread::hardware_concurrency();
+    gActiveConsumer++;
+    std::thread([lQueue] { return fanInConsumer(lQueue, CONSUMER_CPU); }).detach();
+    std::vector<std::thread> lProducers;
+    for (uint64_t i = 0; i < aProducers; i++) {
+        int32_t lCPU = PRODUCER_CPU + (int32_t) i;
+        lProducers.emplace_back([lQueue, lCPU, lCPUs] { return fanInProducer(lQueue, lCPU < lCPUs ? lCPU : -1); });
+    }
+    std::this_thread::sleep_for(std::chrono::milliseconds(10));
+
+    std::cout << "FanInQueue " << aProducers << " producer(s) test started." << std::endl;
+    gStartBench = true;
+    std::this_thread::sleep_for(std::chrono::seconds(TEST_TIME_DURATION_SEC));
+    gActiveProducer = false;
+    for (auto &rProducer: lProducers) {
+        rProducer.join();
+    }
+    lQueue->stopQueue();
+    std::cout << "FanInQueue " << aProducers << " producer(s) test ended." << std::endl;
+    while (gActiveConsumer) {
+        std::this_thread::sleep_for(std::chrono::milliseconds(1));
+    }
+    delete lQueue;
+
+    std::cout << "FanInQueue " << aProducers << " producer(s) Transactions -> "
+              << gCounter / TEST_TIME_DURATION_SEC << "/s" << std::endl;
+}
+
+/// -----------------------------------------------------------
+///
+/// FanInQueue section End
+///
+/// -----------------------------------------------------------
+
+/// -----------------------------------------------------------
+///
+/// Broadcast section Start
+///
+/// -----------------------------------------------------------
+
+//Every consumer must see every item so the items are values, index 0 marks the end.
+
+//CPU for thread number aThread of a test with many consumers. The first runs on CONSUMER_CPU the rest on the
+//CPUs after PRODUCER_CPU, -1 (unpinned) if there are not enough CPUs.
+int32_t consumerCPU(uint64_t aThread) {
+    if (!aThread) {
+        return CONSUMER_CPU;
+    }
+    int32_t lCPU = PRODUCER_CPU + (int32_t) aThread;
+    return lCPU < (int32_t) std::thread::hardware_concurrency() ? lCPU : -1;
+}
+
+using Broadcast = FastQueueBroadcast<uint64_t, BROADCAST_CONSUMERS, QUEUE_MASK, L1_CACHE_LINE>;
+using FanOutQueue = FastQueue<uint64_t, QUEUE_MASK, L1_CACHE_LINE>;
+
+uint64_t broadcastPop(Broadcast *pQueue, uint64_t aConsumer) {
+    return pQueue->pop(aConsumer);
+}
+
+//One FastQueue per consumer
+uint64_t broadcastPop(FanOutQueue *pQueues, uint64_t aConsumer) {
+    return pQueues[aConsumer].pop();
+}
+
+template<typename QUEUE>
+void broadcastConsumer(QUEUE *pQueue, uint64_t aConsumer) {
+    int32_t lCPU = consumerCPU(aConsumer);
+    if (lCPU >= 0 && !pinThread(lCPU)) {
+        std::cout << "Pin CPU fail. " << std::endl;
+        gActiveConsumer--;
+        return;
+    }
+    uint64_t lCounter = 1;
+    while (true) {
+        uint64_t lResult = broadcastPop(pQueue, aConsumer);
+        if (!lResult) {
+            break;
+        }
+        if (lResult != lCounter) {
+            std::cout << "Queue item error" << std::endl;
+        }
+        lCounter++;
+    }
+    gCounter += lCounter - 1;
+    gActiveConsumer--;
+}
+
+//One producer feeding BROADCAST_CONSUMERS consumers. Either one FastQueueBroadcast or one FastQueue per consumer
+//where the producer pushes every item to all queues.
+template<typename QUEUE>
+void broadcastTest(const std::string &rName, QUEUE *pQueue, uint64_t aQueues) {
+    gStartBench = false;
+    gActiveProducer = true;
+    gCounter = 0;
+    gActiveConsumer = 0;
+
+    for (uint64_t i = 0; i < BROADCAST_CONSUMERS; i++) {
+        gActiveConsumer++;
+        std::thread([pQueue, i] { return broadcastConsumer(pQueue, i); }).detach();
+    }
+    std::thread([pQueue, aQueues] {
+        if (!pinThread(PRODUCER_CPU)) {
+            std::cout << "Pin CPU fail. " << std::endl;
+            return;
+        }
+        while (!gStartBench) {
+#ifdef _MSC_VER
+            __nop();
+#else
+            asm volatile ("NOP");
+#endif
+        }
+        uint64_t lCounter = 1;
+        while (gActiveProducer) {
+            for (uint64_t i = 0; i < aQueues; i++) {
+                pQueue[i].push(lCounter);
+            }
+            lCounter++;
+        }
+        for (uint64_t i = 0; i < aQueues; i++) {
+            pQueue[i].stopQueue();
+        }
+    }).detach();
+    std::this_thread::sleep_for(std::chrono::milliseconds(10));
+
+    std::cout << rName << " fan-out test started." << std::endl;
+    gStartBench = true;
+    std::this_thread::sleep_for(std::chrono::seconds(TEST_TIME_DURATION_SEC));
+    gActiveProducer = false;
+    std::cout << rName << " fan-out test ended." << std::endl;
+    while (gActiveConsumer) {
+        std::this_thread::sleep_for(std::chrono::milliseconds(1));
+    }
+
+    //Items produced per second, every item is delivered to all consumers
+    std::cout << rName << " 1->" << BROADCAST_CONSUMERS << " Transactions -> "
+              << gCounter / BROADCAST_CONSUMERS / TEST_TIME_DURATION_SEC << "/s" << std::endl;
+}
+
+/// -----------------------------------------------------------
+///
+/// Broadcast section End
+///
+/// -----------------------------------------------------------
+
+/// -----------------------------------------------------------
+///
+/// Work-stealing section Start
+///
+/// -----------------------------------------------------------
+
+struct MyTask {
+    uint64_t mCost;
+    uint64_t mTimeStamp;
+};
+
+using StealPool = FastQueueStealPool<MyTask, STEAL_WORKERS, QUEUE_MASK, L1_CACHE_LINE>;
+
+void runTask(const MyTask &rTask) {
+    for (uint64_t i = 0; i < rTask.mCost; i++) {
+#ifdef _MSC_VER
+        __nop();
+#else
+        asm volatile ("NOP");
+#endif
+    }
+}
+
+void stealWorker(StealPool *pPool, uint64_t aWorker, bool aSteal, std::vector<uint64_t> *pLatencies) {
+    int32_t lCPU = consumerCPU(aWorker);
+    if (lCPU >= 0 && !pinThread(lCPU)) {
+        std::cout << "Pin CPU fail. " << std::endl;
+        gActiveConsumer--;
+        return;
+    }
+    MyTask lTasks[BULK_SIZE];
+    uint64_t lCounter = 0;
+    while (true) {
+        uint64_t lCount = aSteal ? pPool->pop(aWorker, lTasks, BULK_SIZE) : pPool->popBatch(aWorker, lTasks,
+                                                                                              BULK_SIZE);
+        if (!lCount) {
+            if (pPool->isDrained()) {
+                break;
+            }
+            continue;
+        }
+        for (uint64_t i = 0; i < lCount; i++) {
+            runTask(lTasks[i]);
+            //Sample the latency of every 64th task
+            if (!(lCounter++ & 63)) {
+                pLatencies->push_back(nowNs() - lTasks[i].mTimeStamp);
+            }
+        }
+    }
+    gCounter += lCounter;
+    gActiveConsumer--;
+}
+
+//One scheduler thread hands out tasks round-robin. The tasks for worker 0 are STEAL_HEAVY_FACTOR times as
+//expensive so without stealing worker 0 backs up and stalls the scheduler.
+void workStealingTest(const std::string &rName, bool aSteal) {
+    gStartBench = false;
+    gActiveProducer = true;
+    gCounter = 0;
+    gActiveConsumer = 0;
+
+    auto lPool = new StealPool();
+    std::vector<std::vector<uint64_t>> lLatencies(STEAL_WORKERS);
+    for (uint64_t i = 0; i < STEAL_WORKERS; i++) {
+        gActiveConsumer++;
+        auto lpLatencies = &lLatencies[i];
+        std::thread([lPool, i, aSteal, lpLatencies] { return stealWorker(lPool, i, aSteal, lpLatencies); }).detach();
+    }
+    std::thread([lPool] {
+        if (!pinThread(PRODUCER_CPU)) {
+            std::cout << "Pin CPU fail. " << std::endl;
+            lPool->stopQueue();
+            return;
+        }
+        while (!gStartBench) {
+#ifdef _MSC_VER
+            __nop();
+#else
+            asm volatile ("NOP");
+#endif
+        }
+        uint64_t lCounter = 0;
+        while (gActiveProducer) {
+            uint64_t lWorker = lCounter++ % STEAL_WORKERS;
+            uint64_t lCost = lWorker ? STEAL_TASK_COST : STEAL_TASK_COST * STEAL_HEAVY_FACTOR;
+            MyTask lTask = {lCost, nowNs()};
+            lPool->push(lWorker, lTask);
+        }
+        lPool->stopQueue();
+    }).detach();
+    std::this_thread::sleep_for(std::chrono::milliseconds(10));
+
+    std::cout << rName << " work-stealing test started." << std::endl;
+    gStartBench = true;
+    std::this_thread::sleep_for(std::chrono::seconds(TEST_TIME_DURATION_SEC));
+    gActiveProducer = false;
+    std::cout << rName << " work-stealing test ended." << std::endl;
+    while (gActiveConsumer) {
+        std::this_thread::sleep_for(std::chrono::milliseconds(1));
+    }
+    delete lPool;
+
+    std::vector<uint64_t> lAll;
+    for (auto &rLatencies: lLatencies) {
+        lAll.insert(lAll.end(), rLatencies.begin(), rLatencies.end());
+    }
+    std::sort(lAll.begin(), lAll.end());
+    std::cout << rName << " Transactions -> " << gCounter / TEST_TIME_DURATION_SEC << "/s latency p50 "
+              << percentile(lAll, 0.5) << "ns p99 " << percentile(lAll, 0.99) << "ns max "
+              << percentile(lAll, 1.0) << "ns" << std::endl;
+}
+
+/// -----------------------------------------------------------
+///
+/// Work-stealing section End
+///
+/// -----------------------------------------------------------
+
+/// -----------------------------------------------------------
+///
+/// Framed message section Start
+///
+/// -----------------------------------------------------------
+
+//The message sizes cycle through BYTE_MESSAGE_MIN - BYTE_MESSAGE_MAX. The first 8 bytes is the counter.
+uint64_t byteMessageSize(uint64_t aCounter) {
+    return BYTE_MESSAGE_MIN + (aCounter * 7919) % (BYTE_MESSAGE_MAX - BYTE_MESSAGE_MIN + 1);
+}
+
+uint8_t gBytePayload[BYTE_MESSAGE_MAX];
+
+//A heap allocated vector per message, allocated by the producer and freed by the consumer
+void fastQueueProducerVector(FastQueue<std::vector<uint8_t> *, QUEUE_MASK, L1_CACHE_LINE> *pQueue, int32_t aCPU) {
+    if (!pinThread(aCPU)) {
+        std::cout << "Pin CPU fail. " << std::endl;
+        return;
+    }
+    while (!gStartBench) {
+#ifdef _MSC_VER
+        __nop();
+#else
+        asm volatile ("NOP");
+#endif
+    }
+    uint64_t lCounter = 0;
+    while (gActiveProducer) {
+        uint64_t lSize = byteMessageSize(lCounter);
+        auto lpMessage = new std::vector<uint8_t>(gBytePayload, gBytePayload + lSize);
+        *(uint64_t *) lpMessage->data() = lCounter++;
+        pQueue->push(lpMessage);
+    }
+    pQueue->stopQueue();
+}
+
+void fastQueueConsumerVector(FastQueue<std::vector<uint8_t> *, QUEUE_MASK, L1_CACHE_LINE> *pQueue, int32_t aCPU) {
+    if (!pinThread(aCPU)) {
+        std::cout << "Pin CPU fail. " << std::endl;
+        gActiveConsumer--;
+        return;
+    }
+    uint64_t lCounter = 0;
+    while (true) {
+        auto lpMessage = pQueue->pop();
+        if (lpMessage == nullptr) {
+            break;
+        }
+        if (*(uint64_t *) lpMessage->data() != lCounter || lpMessage->size() != byteMessageSize(lCounter)) {
+            std::cout << "Queue item error" << std::endl;
+        }
+        lCounter++;
+        delete lpMessage;
+    }
+    gCounter += lCounter;
+    gActiveConsumer--;
+}
+
+//The messages are written straight into the byte ring
+void fastByteQueueProducer(FastByteQueue<BYTE_QUEUE_BYTES, L1_CACHE_LINE> *pQueue, int32_t aCPU) {
+    if (!pinThread(aCPU)) {
+        std::cout << "Pin CPU fail. " << std::endl;
+        return;
+    }
+    while (!gStartBench) {
+#ifdef _MSC_VER
+        __nop();
+#else
+        asm volatile ("NOP");
+#endif
+    }
+    uint64_t lCounter = 0;
+    while (gActiveProducer) {
+        uint64_t lSize = byteMessageSize(lCounter);
+        uint8_t *lpMessage = pQueue->reserve(lSize);
+        if (!lpMessage) {
+            continue;
+        }
+        std::memcpy(lpMessage, gBytePayload, lSize);
+        *(uint64_t *) lpMessage = lCounter++;
+        pQueue->commit();
+    }
+    pQueue->stopQueue();
+}
+
+void fastByteQueueConsumer(FastByteQueue<BYTE_QUEUE_BYTES, L1_CACHE_LINE> *pQueue, int32_t aCPU) {
+    if (!pinThread(aCPU)) {
+        std::cout << "Pin CPU fail. " << std::endl;
+        gActiveConsumer--;
+        return;
+    }
+    uint64_t lCounter = 0;
+    while (true) {
+        uint64_t lSize = 0;
+        const uint8_t *lpMessage = pQueue->read(lSize);
+        if (!lpMessage) {
+            if (pQueue->isDrained()) {
+                break;
+            }
+            continue;
+        }
+        if (*(const uint64_t *) lpMessage != lCounter || lSize != byteMessageSize(lCounter)) {
+            std::cout << "Queue item error" << std::endl;
+        }
+        lCounter++;
+        pQueue->release();
+    }
+    gCounter += lCounter;
+    gActiveConsumer--;
+}
+
+/// -----------------------------------------------------------
+///
+/// Framed message section End
+///
+/// -----------------------------------------------------------
+
+/// -----------------------------------------------------------
+///
+/// Recycling section Start
+///
+/// -----------------------------------------------------------
+
+struct MyBuffer {
+    uint64_t mIndex;
+    uint8_t mData[RECYCLE_BUFFER_SIZE];
+};
+
+//Allocated by the producer, freed by the consumer
+void fastQueueProducerBuffer(FastQueue<MyBuffer *, QUEUE_MASK, L1_CACHE_LINE> *pQueue, int32_t aCPU) {
+    if (!pinThread(aCPU)) {
+        std::cout << "Pin CPU fail. " << std::endl;
+        return;
+    }
+    while (!gStartBench) {
+#ifdef _MSC_VER
+        __nop();
+#else
+        asm volatile ("NOP");
+#endif
+    }
+    uint64_t lCounter = 0;
+    while (gActiveProducer) {
+        auto lpBuffer = new MyBuffer();
+        lpBuffer->mIndex = lCounter++;
+        pQueue->push(lpBuffer);
+    }
+    pQueue->stopQueue();
+}
+
+void fastQueueConsumerBuffer(FastQueue<MyBuffer *, QUEUE_MASK, L1_CACHE_LINE> *pQueue, int32_t aCPU) {
+    if (!pinThread(aCPU)) {
+        std::cout << "Pin CPU fail. " << std::endl;
+        gActiveConsumer--;
+        return;
+    }
+    uint64_t lCounter = 0;
+    while (true) {
+        auto lpBuffer = pQueue->pop();
+        if (lpBuffer == nullptr) {
+            break;
+        }
+        if (lpBuffer->mIndex != lCounter) {
+            std::cout << "Queue item error" << std::endl;
+        }
+        lCounter++;
+        delete lpBuffer;
+    }
+    gCounter += lCounter;
+    gActiveConsumer--;
+}
+
+//The buffers go back to the producer on the return ring
+void fastQueueProducerRecycle(FastQueueRecycler<MyBuffer, QUEUE_MASK, L1_CACHE_LINE> *pQueue, int32_t aCPU) {
+    if (!pinThread(aCPU)) {
+        std::cout << "Pin CPU fail. " << std::endl;
+        return;
+    }
+    while (!gStartBench) {
+#ifdef _MSC_VER
+        __nop();
+#else
+        asm volatile ("NOP");
+#endif
+    }
+    uint64_t lCounter = 0;
+    while (gActiveProducer) {
+        auto lpBuffer = pQueue->acquire();
+        if (!lpBuffer) {
+            continue;
+        }
+        //Same work as the constructor of a new MyBuffer
+        *lpBuffer = {};
+        lpBuffer->mIndex = lCounter++;
+        pQueue->push(lpBuffer);
+    }
+    pQueue->stopQueue();
+}
+
+void fastQueueConsumerRecycle(FastQueueRecycler<MyBuffer, QUEUE_MASK, L1_CACHE_LINE> *pQueue, int32_t aCPU) {
+    if (!pinThread(aCPU)) {
+        std::cout << "Pin CPU fail. " << std::endl;
+        gActiveConsumer--;
+        return;
+    }
+    uint64_t lCounter = 0;
+    while (true) {
+        auto lpBuffer = pQueue->pop();
+        if (lpBuffer == nullptr) {
+            break;
+        }
+        if (lpBuffer->mIndex != lCounter) {
+            std::cout << "Queue item error" << std::endl;
+        }
+        lCounter++;
+        pQueue->recycle(lpBuffer);
+    }
+    gCounter += lCounter;
+    gActiveConsumer--;
+}
+
+/// -----------------------------------------------------------
+///
+/// Recycling section End
+///
+/// -----------------------------------------------------------
+
+/// -----------------------------------------------------------
+///
+/// Sweep section Start
+///
+/// -----------------------------------------------------------
+
+//The sweep is driven from the command line, see sweepUsage(). The queues are templates so every depth and
+//payload size is compiled in up front, a depth or payload size not listed here is rejected.
+const std::vector<uint64_t> gSweepDepths = {0xF, 0xFF, 0xFFF, 0xFFFF};
+const std::vector<uint64_t> gSweepPayloads = {8, 32, 64, 256};
+const std::vector<std::string> gSweepQueues = {"fastqueue", "fastqueueraw", "fastqueueasm", "boost", "rigtorp",
+                                               "deaod"};
+//--layouts names, in FastQueueLayout order. Only fastqueue and fastqueueraw have a layout.
+const std::vector<std::string> gSweepLayouts = {"padded", "dense"};
+//--cpus names for the CpuSharing values, in order
+const std::vector<std::string> gSweepSharing = {"smt", "l2", "l3", "numa", "cross"};
+//Count the producer and consumer threads with the hardware performance counters (--perf)
+bool gSweepPerf = false;
+uint64_t gSweepHitmEvent = PerfCounters::defaultHitmEvent();
+
+//Pushed by the producer when the time is up
+#define SWEEP_END UINT64_MAX
+//Round trips not counted in rtt mode
+#define SWEEP_RTT_WARMUP 1000
+
+//Message of SIZE bytes carried by value
+template<uint64_t SIZE>
+struct SweepMessage {
+    uint64_t mIndex;
+    uint8_t mPayload[SIZE - sizeof(uint64_t)];
+};
+
+template<>
+struct SweepMessage<sizeof(uint64_t)> {
+    uint64_t mIndex;
+};
+
+//One adapter per queue. push and pop are blocking.
+template<typename T, uint64_t MASK, FastQueueLayout LAYOUT>
+struct SweepFastQueue {
+    using Queue = FastQueue<T, MASK, L1_CACHE_LINE, LAYOUT>;
+    static Queue *create() { return new Queue(); }
+    static void destroy(Queue *pQueue) { delete pQueue; }
+    static void push(Queue *pQueue, T &rItem) { pQueue->push(rItem); }
+    static void pop(Queue *pQueue, T &rItem) { rItem = pQueue->pop(); }
+};
+
+template<typename T, uint64_t MASK, FastQueueLayout LAYOUT>
+struct SweepFastQueueRaw : SweepFastQueue<T, MASK, LAYOUT> {
+    using Queue = typename SweepFastQueue<T, MASK, LAYOUT>::Queue;
+    static void push(Queue *pQueue, T &rItem) { pQueue->pushRaw(rItem); }
+    static void pop(Queue *pQueue, T &rItem) { pQueue->popRaw(rItem); }
+};
+
+//The ASM queue moves pointers, the index is carried as the pointer value + 1 so the end marker becomes nullptr
+template<uint64_t MASK>
+struct SweepFastQueueASM {
+    using Queue = FastQueueASM::DataBlock;
+    static Queue *create() { return FastQueueASM::newQueue(MASK); }
+    static void destroy(Queue *pQueue) { FastQueueASM::deleteQueue(pQueue); }
+    static void push(Queue *pQueue, SweepMessage<sizeof(uint64_t)> &rItem) {
+        FastQueueASM::push_item(pQueue, (void *) (rItem.mIndex + 1));
+    }
+    static void pop(Queue *pQueue, SweepMessage<sizeof(uint64_t)> &rItem) {
+        rItem.mIndex = (uint64_t) FastQueueASM::pop_item(pQueue) - 1;
+    }
+};
+
+template<typename T, uint64_t MASK>
+struct SweepBoost {
+    using Queue = boost::lockfree::spsc_queue<T, boost::lockfree::capacity<MASK>>;
+    static Queue *create() { return new Queue(); }
+    static void destroy(Queue *pQueue) { delete pQueue; }
+    static void push(Queue *pQueue, T &rItem) { while (!pQueue->push(rItem)); }
+    static void pop(Queue *pQueue, T &rItem) { while (!pQueue->pop(rItem)); }
+};
+
+template<typename T, uint64_t MASK>
+struct SweepRigtorp {
+    using Queue = rigtorp::SPSCQueue<T>;
+    static Queue *create() { return new Queue(MASK); }
+    static void destroy(Queue *pQueue) { delete pQueue; }
+    static void push(Queue *pQueue, T &rItem) { pQueue->push(rItem); }
+    static void pop(Queue *pQueue, T &rItem) {
+        while (!pQueue->front());
+        rItem = *pQueue->front();
+        pQueue->pop();
+    }
+};
+
+template<typename T, uint64_t MASK>
+struct SweepDeaod {
+    using Queue = deaod::spsc_queue<T, MASK, 6>;
+    static Queue *create() { return new Queue(); }
+    static void destroy(Queue *pQueue) { delete pQueue; }
+    static void push(Queue *pQueue, T &rItem) { while (!pQueue->push(rItem)); }
+    static void pop(Queue *pQueue, T &rItem) { while (!pQueue->pop(rItem)); }
+};
+
+struct SweepPoint {
+    std::string mQueue;
+    //Empty for the queues without a layout
+    std::string mLayout;
+    uint64_t mDepth;
+    uint64_t mPayload;
+    int32_t mConsumerCPU;
+    int32_t mProducerCPU;
+};
+
+//Performance counters of one thread summed over the runs
+struct SweepCounters {
+    uint64_t mValue[PerfCounters::COUNTERS] = {};
+    bool mAvailable[PerfCounters::COUNTERS] = {};
+
+    //Called by the measured thread when the test starts
+    static void begin(PerfCounters &rCounters) {
+        if (gSweepPerf) {
+            rCounters.open();
+            rCounters.start();
+        }
+    }
+
+    //Called by the measured thread when the test is done
+    void end(PerfCounters &rCounters) {
+        rCounters.stop();
+        for (int i = 0; i < PerfCounters::COUNTERS; i++) {
+            if (rCounters.available((PerfCounters::Counter) i)) {
+                mValue[i] += rCounters.value((PerfCounters::Counter) i);
+                mAvailable[i] = true;
+            }
+        }
+    }
+};
+
+//Throughput mode holds the transactions/s of every run, rtt mode a histogram of the RTT of every item of all runs
+struct SweepResult {
+    SweepPoint mPoint;
+    uint64_t mRuns = 0;
+    std::vector<uint64_t> mValues;
+    FastQueueLatencyHistogram mRtt;
+    //Items (throughput) or round trips (rtt) covered by the counters
+    uint64_t mOperations = 0;
+    SweepCounters mProducer;
+    SweepCounters mConsumer;
+};
+
+//Saturated one way throughput, adds the transactions/s of the run to the result
+struct SweepThroughput {
+    template<typename ADAPTER, typename T>
+    static bool run(SweepResult &rResult, uint64_t aDurationSec) {
+        auto &rPoint = rResult.mPoint;
+        auto lpQueue = ADAPTER::create();
+        PinStart lStart;
+        std::atomic<bool> lActive = true;
+        uint64_t lCounter = 0;
+
+        std::thread lConsumer([&] {
+            if (!lStart.ready(rPoint.mConsumerCPU)) {
+                return;
+            }
+            PerfCounters lCounters(gSweepHitmEvent);
+            SweepCounters::begin(lCounters);
+            T lItem;
+            while (true) {
+                ADAPTER::pop(lpQueue, lItem);
+                if (lItem.mIndex == SWEEP_END) {
+                    break;
+                }
+                if (lItem.mIndex != lCounter) {
+                    std::cerr << "Queue item error " << rPoint.mQueue << std::endl;
+                }
+                lCounter++;
+            }
+            rResult.mConsumer.end(lCounters);
+        });
+        std::thread lProducer([&] {
+            if (!lStart.ready(rPoint.mProducerCPU)) {
+                return;
+            }
+            PerfCounters lCounters(gSweepHitmEvent);
+            SweepCounters::begin(lCounters);
+            T lItem = {};
+            uint64_t lIndex = 0;
+            while (lActive.load(std::memory_order_relaxed)) {
+                lItem.mIndex = lIndex++;
+                ADAPTER::push(lpQueue, lItem);
+            }
+            lItem.mIndex = SWEEP_END;
+            ADAPTER::push(lpQueue, lItem);
+            rResult.mProducer.end(lCounters);
+        });
+
+        uint64_t lStartTime = nowNs();
+        bool lPinned = lStart.go();
+        if (lPinned) {
+            lStartTime = nowNs();
+            std::this_thread::sleep_for(std::chrono::seconds(aDurationSec));
+            lActive = false;
+        }
+        uint64_t lEndTime = nowNs();
+        lConsumer.join();
+        lProducer.join();
+        ADAPTER::destroy(lpQueue);
+        if (!lPinned) {
+            return false;
+        }
+        rResult.mValues.push_back(lCounter * 1000000000 / (lEndTime - lStartTime));
+        rResult.mOperations += lCounter;
+        return true;
+    }
+};
+
+//Round trip A -> B -> A through two queues, adds the RTT of every item in ns to the result.
+//The initiator waits for the echo before sending the next item so the queues are empty every time
+//and the RTT is two wake-to-consume latencies.
+struct SweepRoundTrip {
+    template<typename ADAPTER, typename T>
+    static bool run(SweepResult &rResult, uint64_t aDurationSec) {
+        auto &rPoint = rResult.mPoint;
+        auto lpPing = ADAPTER::create();
+        auto lpPong = ADAPTER::create();
+        PinStart lStart;
+        std::atomic<bool> lActive = true;
+        //Fixed size, the 10^8 round trips of a 20s run do not grow it
+        FastQueueLatencyHistogram lRtt;
+        uint64_t lRoundTrips = 0;
+
+        //The echo runs on the consumer CPU
+        std::thread lEcho([&] {
+            if (!lStart.ready(rPoint.mConsumerCPU)) {
+                return;
+            }
+            PerfCounters lCounters(gSweepHitmEvent);
+            SweepCounters::begin(lCounters);
+            T lItem;
+            while (true) {
+                ADAPTER::pop(lpPing, lItem);
+                if (lItem.mIndex == SWEEP_END) {
+                    break;
+                }
+                ADAPTER::push(lpPong, lItem);
+            }
+            rResult.mConsumer.end(lCounters);
+        });
+        std::thread lInitiator([&] {
+            if (!lStart.ready(rPoint.mProducerCPU)) {
+                return;
+            }
+            PerfCounters lCounters(gSweepHitmEvent);
+            SweepCounters::begin(lCounters);
+            T lItem = {};
+            uint64_t lIndex = 0;
+            while (lActive.load(std::memory_order_relaxed)) {
+                lItem.mIndex = lIndex;
+                uint64_t lSent = fastQueueTicks();
+                ADAPTER::push(lpPing, lItem);
+                ADAPTER::pop(lpPong, lItem);
+                uint64_t lReceived = fastQueueTicks();
+                if (lItem.mIndex != lIndex) {
+                    std::cerr << "Queue item error " << rPoint.mQueue << std::endl;
+                }
+                //Let the caches and the branch predictors warm up
+                if (++lIndex > SWEEP_RTT_WARMUP) {
+                    lRtt.add(lReceived - lSent);
+                }
+            }
+            lItem.mIndex = SWEEP_END;
+            ADAPTER::push(lpPing, lItem);
+            rResult.mProducer.end(lCounters);
+            lRoundTrips = lIndex;
+        });
+
+        bool lPinned = lStart.go();
+        if (lPinned) {
+            std::this_thread::sleep_for(std::chrono::seconds(aDurationSec));
+            lActive = false;
+        }
+        lEcho.join();
+        lInitiator.join();
+        ADAPTER::destroy(lpPing);
+        ADAPTER::destroy(lpPong);
+        if (!lPinned) {
+            return false;
+        }
+        rResult.mRtt.merge(lRtt);
+        rResult.mOperations += lRoundTrips;
+        return true;
+    }
+};
+
+template<typename MODE, uint64_t MASK, typename T, FastQueueLayout LAYOUT>
+bool sweepFastQueue(SweepResult &rResult, uint64_t aDurationSec) {
+    if (rResult.mPoint.mQueue == "fastqueueraw") {
+        return MODE::template run<SweepFastQueueRaw<T, MASK, LAYOUT>, T>(rResult, aDurationSec);
+    }
+    return MODE::template run<SweepFastQueue<T, MASK, LAYOUT>, T>(rResult, aDurationSec);
+}
+
+template<typename MODE, uint64_t MASK, uint64_t SIZE>
+bool sweepQueue(SweepResult &rResult, uint64_t aDurationSec) {
+    using T = SweepMessage<SIZE>;
+    auto &rPoint = rResult.mPoint;
+    if (rPoint.mQueue == "fastqueue" || rPoint.mQueue == "fastqueueraw") {
+        if (rPoint.mLayout == "dense") {
+            return sweepFastQueue<MODE, MASK, T, FastQueueLayout::DENSE>(rResult, aDurationSec);
+        }
+        //A padded slot can not hold an item as large as the cache line, sweepMain skips those points
+        if constexpr (SIZE < L1_CACHE_LINE) {
+            return sweepFastQueue<MODE, MASK, T, FastQueueLayout::PADDED>(rResult, aDurationSec);
+        }
+        return false;
+    } else if (rPoint.mQueue == "fastqueueasm") {
+        //The ASM queue moves pointers only
+        if constexpr (SIZE == sizeof(uint64_t)) {
+            return MODE::template run<SweepFastQueueASM<MASK>, T>(rResult, aDurationSec);
+        }
+        return false;
+    } else if (rPoint.mQueue == "boost") {
+        return MODE::template run<SweepBoost<T, MASK>, T>(rResult, aDurationSec);
+    } else if (rPoint.mQueue == "rigtorp") {
+        return MODE::template run<SweepRigtorp<T, MASK>, T>(rResult, aDurationSec);
+    } else if (rPoint.mQueue == "deaod") {
+        return MODE::template run<SweepDeaod<T, MASK>, T>(rResult, aDurationSec);
+    }
+    return false;
+}
+
+template<typename MODE, uint64_t SIZE>
+bool sweepDepth(SweepResult &rResult, uint64_t aDurationSec) {
+    switch (rResult.mPoint.mDepth) {
+        case 0xF:
+            return sweepQueue<MODE, 0xF, SIZE>(rResult, aDurationSec);
+        case 0xFF:
+            return sweepQueue<MODE, 0xFF, SIZE>(rResult, aDurationSec);
+        case 0xFFF:
+            return sweepQueue<MODE, 0xFFF, SIZE>(rResult, aDurationSec);
+        case 0xFFFF:
+            return sweepQueue<MODE, 0xFFFF, SIZE>(rResult, aDurationSec);
+        default:
+            return false;
+    }
+}
+
+template<typename MODE>
+bool sweepPayload(SweepResult &rResult, uint64_t aDurationSec) {
+    switch (rResult.mPoint.mPayload) {
+        case 8:
+            return sweepDepth<MODE, 8>(rResult, aDurationSec);
+        case 32:
+            return sweepDepth<MODE, 32>(rResult, aDurationSec);
+        case 64:
+            return sweepDepth<MODE, 64>(rResult, aDurationSec);
+        case 256:
+            return sweepDepth<MODE, 256>(rResult, aDurationSec);
+        default:
+            return false;
+    }
+}
+
+struct SweepStats {
+    double mMean = 0;
+    double mStdDev = 0;
+};
+
+SweepStats sweepStats(const std::vector<uint64_t> &rValues) {
+    SweepStats lStats;
+    if (rValues.empty()) {
+        return lStats;
+    }
+    double lSum = 0;
+    for (auto lValue: rValues) {
+        lSum += (double) lValue;
+    }
+    lStats.mMean = lSum / (double) rValues.size();
+    //Sample standard deviation
+    if (rValues.size() > 1) {
+        double lSquares = 0;
+        for (auto lValue: rValues) {
+            lSquares += ((double) lValue - lStats.mMean) * ((double) lValue - lStats.mMean);
+        }
+        lStats.mStdDev = std::sqrt(lSquares / (double) (rValues.size() - 1));
+    }
+    return lStats;
+}
+
+//Counters per operation (item or round trip), n/a (csv empty, json null) when the counter is not available
+void sweepPrintCounters(const SweepResult &rResult, const std::string &rFormat) {
+    if (!gSweepPerf) {
+        return;
+    }
+    std::cout << std::setprecision(2);
+    for (auto lThread: {"producer", "consumer"}) {
+        auto &rCounters = std::string(lThread) == "producer" ? rResult.mProducer : rResult.mConsumer;
+        if (rFormat == "text") {
+            std::cout << "  " << lThread << " per op ->";
+        }
+        for (int i = 0; i < PerfCounters::COUNTERS; i++) {
+            auto lName = PerfCounters::name((PerfCounters::Counter) i);
+            bool lAvailable = rCounters.mAvailable[i] && rResult.mOperations;
+            double lPerOp = lAvailable ? (double) rCounters.mValue[i] / (double) rResult.mOperations : 0;
+            if (rFormat == "csv") {
+                std::cout << ",";
+                if (lAvailable) {
+                    std::cout << lPerOp;
+                }
+            } else if (rFormat == "json") {
+                std::cout << ", \"" << lThread << "_" << lName << "_per_op\": ";
+                if (lAvailable) {
+                    std::cout << lPerOp;
+                } else {
+                    std::cout << "null";
+                }
+            } else {
+                std::cout << " " << lName << " ";
+                if (lAvailable) {
+                    std::cout << lPerOp;
+                } else {
+                    std::cout << "n/a";
+                }
+            }
+        }
+        if (rFormat == "text") {
+            std::cout << std::endl;
+        }
+    }
+    std::cout << std::setprecision(0);
+}
+
+void sweepPrint(std::vector<SweepResult> &rResults, const std::string &rMode, const std::string &rFormat,
+                uint64_t aDurationSec) {
+    const bool lRoundTrip = rMode == "rtt";
+    std::cout << std::fixed << std::setprecision(0);
+    if (rFormat == "csv") {
+        std::cout << "queue,layout,depth,payload_bytes,consumer_cpu,producer_cpu,duration_s,runs,";
+        if (lRoundTrip) {
+            std::cout << "samples,mean_ns,stddev_ns,min_ns,p50_ns,p90_ns,p99_ns,p999_ns,max_ns";
+        } else {
+            std::cout << "mean_per_s,stddev_per_s,min_per_s,max_per_s";
+        }
+        if (gSweepPerf) {
+            for (auto lThread: {"producer", "consumer"}) {
+                for (int i = 0; i < PerfCounters::COUNTERS; i++) {
+                    std::cout << "," << lThread << "_" << PerfCounters::name((PerfCounters::Counter) i) << "_per_op";
+                }
+            }
+        }
+        std::cout << std::endl;
+    } else if (rFormat == "json") {
+        std::cout << "[" << std::endl;
+    }
+    for (size_t i = 0; i < rResults.size(); i++) {
+        auto &rResult = rResults[i];
+        auto &rPoint = rResult.mPoint;
+        auto &rRtt = rResult.mRtt;
+        std::sort(rResult.mValues.begin(), rResult.mValues.end());
+        auto lStats = sweepStats(rResult.mValues);
+        uint64_t lMin = lRoundTrip ? rRtt.minNs() : rResult.mValues.front();
+        uint64_t lMax = lRoundTrip ? rRtt.maxNs() : rResult.mValues.back();
+        if (rFormat == "csv") {
+            std::cout << rPoint.mQueue << "," << rPoint.mLayout << "," << rPoint.mDepth << "," << rPoint.mPayload << ","
+                      << rPoint.mConsumerCPU << "," << rPoint.mProducerCPU << "," << aDurationSec << ","
+                      << rResult.mRuns << ",";
+            if (lRoundTrip) {
+                std::cout << rRtt.samples() << "," << rRtt.meanNs() << "," << rRtt.stdDevNs() << "," << lMin
+                          << "," << rRtt.percentileNs(0.5) << "," << rRtt.percentileNs(0.9) << ","
+                          << rRtt.percentileNs(0.99) << "," << rRtt.percentileNs(0.999) << "," << lMax;
+            } else {
+                std::cout << lStats.mMean << "," << lStats.mStdDev << "," << lMin << "," << lMax;
+            }
+            sweepPrintCounters(rResult, rFormat);
+            std::cout << std::endl;
+        } else if (rFormat == "json") {
+            std::cout << "  {\"queue\": \"" << rPoint.mQueue << "\", \"layout\": ";
+            if (rPoint.mLayout.empty()) {
+                std::cout << "null";
+            } else {
+                std::cout << "\"" << rPoint.mLayout << "\"";
+            }
+            std::cout << ", \"depth\": " << rPoint.mDepth
+                      << ", \"payload_bytes\": " << rPoint.mPayload << ", \"consumer_cpu\": " << rPoint.mConsumerCPU
+                      << ", \"producer_cpu\": " << rPoint.mProducerCPU << ", \"duration_s\": " << aDurationSec
+                      << ", \"runs\": " << rResult.mRuns;
+            if (lRoundTrip) {
+                std::cout << ", \"samples\": " << rRtt.samples() << ", \"mean_ns\": " << rRtt.meanNs()
+                          << ", \"stddev_ns\": " << rRtt.stdDevNs() << ", \"min_ns\": " << lMin
+                          << ", \"p50_ns\": " << rRtt.percentileNs(0.5)
+                          << ", \"p90_ns\": " << rRtt.percentileNs(0.9)
+                          << ", \"p99_ns\": " << rRtt.percentileNs(0.99)
+                          << ", \"p999_ns\": " << rRtt.percentileNs(0.999) << ", \"max_ns\": " << lMax;
+            } else {
+                std::cout << ", \"mean_per_s\": " << lStats.mMean << ", \"stddev_per_s\": " << lStats.mStdDev
+                          << ", \"min_per_s\": " << lMin << ", \"max_per_s\": " << lMax;
+            }
+            sweepPrintCounters(rResult, rFormat);
+            std::cout << "}" << (i + 1 < rResults.size() ? "," : "") << std::endl;
+        } else {
+            std::cout << rPoint.mQueue << " layout " << (rPoint.mLayout.empty() ? "n/a" : rPoint.mLayout)
+                      << " depth " << rPoint.mDepth << " payload " << rPoint.mPayload << " cpu " << rPoint.mConsumerCPU << ":" << rPoint.mProducerCPU;
+            if (lRoundTrip) {
+                std::cout << " RTT -> p50 " << rRtt.percentileNs(0.5) << "ns p90 " << rRtt.percentileNs(0.9)
+                          << "ns p99 " << rRtt.percentileNs(0.99) << "ns p99.9 " << rRtt.percentileNs(0.999)
+                          << "ns max " << lMax << "ns (samples " << rRtt.samples() << " runs " << rResult.mRuns << ")"
+                          << std::endl;
+            } else {
+                std::cout << " Transactions -> " << lStats.mMean << "/s (stddev " << lStats.mStdDev << " min "
+                          << lMin << " max " << lMax << " runs " << rResult.mRuns << ")" << std::endl;
+            }
+            sweepPrintCounters(rResult, rFormat);
+        }
+    }
+    if (rFormat == "json") {
+        std::cout << "]" << std::endl;
+    }
+}
+
+void sweepUsage() {
+    std::cerr << "Usage: fast_queue_compare (no arguments runs the full comparison)" << std::endl;
+    std::cerr << "       fast_queue_compare [options] (runs a sweep)" << std::endl;
+    std::cerr << "  --mode m          throughput or rtt (ping-pong round trip) (default throughput)" << std::endl;
+    std::cerr << "  --queues a,b,..   fastqueue fastqueueraw fastqueueasm boost rigtorp deaod (default all)" << std::endl;
+    std::cerr << "  --layouts a,b,..  padded dense, the fastqueue(raw) ring buffer layout (default padded)" << std::endl;
+    std::cerr << "  --depths a,b,..   queue depth 15 255 4095 65535 (default " << QUEUE_MASK << ")" << std::endl;
+    std::cerr << "  --payloads a,b,.. message size in bytes 8 32 64 256 (default 8)" << std::endl;
+    std::cerr << "  --cpus c:p,..     consumer:producer CPU pairs (default " << CONSUMER_CPU << ":" << PRODUCER_CPU
+              << ")" << std::endl;
+    std::cerr << "                    in rtt mode the echo runs on c and the initiator on p" << std::endl;
+    std::cerr << "                    smt l2 l3 numa picks a pair sharing the core, L2, L3 or NUMA node" << std::endl;
+    std::cerr << "                    cross picks a pair on different NUMA nodes" << std::endl;
+    std::cerr << "  --topology        print the pair picked for smt l2 l3 numa cross and exit" << std::endl;
+    std::cerr << "  --duration s      seconds per run (default " << TEST_TIME_DURATION_SEC << ")" << std::endl;
+    std::cerr << "  --repetitions n   runs per point (default 1)" << std::endl;
+    std::cerr << "  --format f        text csv json (default text)" << std::endl;
+    std::cerr << "  --perf            count cycles, instructions, L1D misses, LLC misses and HITM per operation" << std::endl;
+    std::cerr << "                    for the producer and the consumer thread (Linux perf_event_open)" << std::endl;
+    std::cerr << "  --perf-hitm e     raw perf event used for HITM (default 0x" << std::hex
+              << PerfCounters::defaultHitmEvent() << std::dec << ", 0 = not available)" << std::endl;
+    std::cerr << "fastqueueasm only runs with payload 8. padded only runs with payloads below " << L1_CACHE_LINE
+              << "." << std::endl;
+}
+
+std::vector<std::string> sweepSplit(const std::string &rList) {
+    std::vector<std::string> lItems;
+    size_t lStart = 0;
+    while (lStart <= rList.size()) {
+        size_t lEnd = rList.find(',', lStart);
+        if (lEnd == std::string::npos) {
+            lEnd = rList.size();
+        }
+        if (lEnd > lStart) {
+            lItems.push_back(rList.substr(lStart, lEnd - lStart));
+        }
+        lStart = lEnd + 1;
+    }
+    return lItems;
+}
+
+int sweepMain(int argc, char *argv[]) {
+    std::string lMode = "throughput";
+    std::vector<std::string> lQueues = gSweepQueues;
+    std::vector<std::string> lLayouts = {"padded"};
+    std::vector<uint64_t> lDepths = {QUEUE_MASK};
+    std::vector<uint64_t> lPayloads = {8};
+    std::vector<std::pair<int32_t, int32_t>> lCPUs = {{CONSUMER_CPU, PRODUCER_CPU}};
+    uint64_t lDurationSec = TEST_TIME_DURATION_SEC;
+    uint64_t lRepetitions = 1;
+    std::string lFormat = "text";
+
+    try {
+        for (int i = 1; i < argc; i++) {
+            std::string lOption = argv[i];
+            if (lOption == "--help" || lOption == "-h") {
+                sweepUsage();
+                return 0;
+            }
+            if (lOption == "--topology") {
+                auto lTopology = cpuTopology();
+                for (size_t lSharing = 0; lSharing < gSweepSharing.size(); lSharing++) {
+                    int32_t lConsumer, lProducer;
+                    std::cout << gSweepSharing[lSharing] << " ";
+                    if (pickCpuPair(lTopology, (CpuSharing) lSharing, lConsumer, lProducer)) {
+                        std::cout << lConsumer << ":" << lProducer << std::endl;
+                    } else {
+                        std::cout << "none" << std::endl;
+                    }
+                }
+                return 0;
+            }
+            if (lOption == "--perf") {
+                gSweepPerf = true;
+                continue;
+            }
+            if (i + 1 >= argc) {
+                throw std::invalid_argument("missing value for " + lOption);
+            }
+            std::string lValue = argv[++i];
+            if (lOption == "--mode") {
+                lMode = lValue;
+                if (lMode != "throughput" && lMode != "rtt") {
+                    throw std::invalid_argument("unknown mode " + lMode);
+                }
+            } else if (lOption == "--queues") {
+                lQueues = sweepSplit(lValue);
+                for (auto &rQueue: lQueues) {
+                    if (std::find(gSweepQueues.begin(), gSweepQueues.end(), rQueue) == gSweepQueues.end()) {
+                        throw std::invalid_argument("unknown queue " + rQueue);
+                    }
+                }
+            } else if (lOption == "--layouts") {
+                lLayouts = sweepSplit(lValue);
+                for (auto &rLayout: lLayouts) {
+                    if (std::find(gSweepLayouts.begin(), gSweepLayouts.end(), rLayout) == gSweepLayouts.end()) {
+                        throw std::invalid_argument("unknown layout " + rLayout);
+                    }
+                }
+            } else if (lOption == "--depths" || lOption == "--payloads") {
+                auto &rTarget = lOption == "--depths" ? lDepths : lPayloads;
+                auto &rSupported = lOption == "--depths" ? gSweepDepths : gSweepPayloads;
+                rTarget.clear();
+                for (auto &rItem: sweepSplit(lValue)) {
+                    uint64_t lNumber = std::stoull(rItem, nullptr, 0);
+                    if (std::find(rSupported.begin(), rSupported.end(), lNumber) == rSupported.end()) {
+                        throw std::invalid_argument(rItem + " is not compiled in for " + lOption);
+                    }
+                    rTarget.push_back(lNumber);
+                }
+            } else if (lOption == "--cpus") {
+                lCPUs.clear();
+                for (auto &rPair: sweepSplit(lValue)) {
+                    size_t lColon = rPair.find(':');
+                    if (lColon != std::string::npos) {
+                        lCPUs.emplace_back(std::stoi(rPair.substr(0, lColon)), std::stoi(rPair.substr(lColon + 1)));
+                        continue;
+                    }
+                    //Picked from the topology
+                    int32_t lConsumer, lProducer;
+                    auto lSharing = std::find(gSweepSharing.begin(), gSweepSharing.end(), rPair);
+                    if (lSharing == gSweepSharing.end()) {
+                        throw std::invalid_argument("CPU pair " + rPair + " is not consumer:producer or smt l2 l3 numa cross");
+                    }
+                    if (!pickCpuPair((CpuSharing) (lSharing - gSweepSharing.begin()), lConsumer, lProducer)) {
+                        throw std::invalid_argument("no CPU pair sharing " + rPair + " found");
+                    }
+                    lCPUs.emplace_back(lConsumer, lProducer);
+                }
+            } else if (lOption == "--perf-hitm") {
+                gSweepHitmEvent = std::stoull(lValue, nullptr, 0);
+            } else if (lOption == "--duration") {
+                lDurationSec = std::stoull(lValue);
+            } else if (lOption == "--repetitions") {
+                lRepetitions = std::stoull(lValue);
+            } else if (lOption == "--format") {
+                lFormat = lValue;
+                if (lFormat != "text" && lFormat != "csv" && lFormat != "json") {
+                    throw std::invalid_argument("unknown format " + lFormat);
+                }
+            } else {
+                throw std::invalid_argument("unknown option " + lOption);
+            }
+        }
+        if (lQueues.empty() || lLayouts.empty() || lDepths.empty() || lPayloads.empty() || lCPUs.empty() || !lDurationSec ||
+            !lRepetitions) {
+            throw std::invalid_argument("empty sweep");
+        }
+    } catch (const std::exception &rError) {
+        std::cerr << "Error: " << rError.what() << std::endl;
+        sweepUsage();
+        return 1;
+    }
+
+    //Progress goes to stderr so stdout only holds the results
+    std::vector<SweepResult> lResults;
+    for (auto &rQueue: lQueues) {
+        bool lHasLayout = rQueue == "fastqueue" || rQueue == "fastqueueraw";
+        for (auto &rLayout: lHasLayout ? lLayouts : std::vector<std::string>{""}) {
+            for (auto lDepth: lDepths) {
+                for (auto lPayload: lPayloads) {
+                    for (auto &rCPUs: lCPUs) {
+                        SweepResult lResult;
+                        lResult.mPoint = {rQueue, rLayout, lDepth, lPayload, rCPUs.first, rCPUs.second};
+                        if (rQueue == "fastqueueasm" && lPayload != sizeof(uint64_t)) {
+                            std::cerr << "Skipping fastqueueasm payload " << lPayload << std::endl;
+                            continue;
+                        }
+                        if (rLayout == "padded" && lPayload >= L1_CACHE_LINE) {
+                            std::cerr << "Skipping " << rQueue << " padded payload " << lPayload
+                                      << " (a padded slot holds less than " << L1_CACHE_LINE << " bytes)"
+                                      << std::endl;
+                            continue;
+                        }
+                        for (uint64_t lRun = 0; lRun < lRepetitions; lRun++) {
+                            std::cerr << lMode << " " << rQueue << (rLayout.empty() ? "" : " " + rLayout)
+                                      << " depth " << lDepth << " payload " << lPayload << " cpu " << rCPUs.first
+                                      << ":" << rCPUs.second << " run " << lRun + 1 << "/" << lRepetitions
+                                      << std::endl;
+                            bool lDone = lMode == "rtt" ?
+                                         sweepPayload<SweepRoundTrip>(lResult, lDurationSec) :
+                                         sweepPayload<SweepThroughput>(lResult, lDurationSec);
+                            if (!lDone) {
+                                std::cerr << "Pin CPU fail. " << std::endl;
+                                continue;
+                            }
+                            lResult.mRuns++;
+                        }
+                        if (!lResult.mValues.empty() || lResult.mRtt.samples()) {
+                            lResults.push_back(std::move(lResult));
+                        }
+                    }
+                }
+            }
+        }
+    }
+    sweepPrint(lResults, lMode, lFormat, lDurationSec);
+    return 0;
+}
+
+/// -----------------------------------------------------------
+///
+/// Sweep section End
+///
+/// -----------------------------------------------------------
+
+int main(int argc, char *argv[]) {
+    if (argc > 1) {
+        return sweepMain(argc, argv);
+    }
+
+    ///
+    /// BoostLockfree test ->
+    ///
+
+    // Create the queue
+    auto lBoostLockFree = new boost::lockfree::spsc_queue<MyObject *, boost::lockfree::capacity<QUEUE_MASK>>;
+
+    // Start the consumer(s) / Producer(s)
+    gActiveConsumer++;
+    std::thread([lBoostLockFree] { return boostLockFreeConsumer(lBoostLockFree, CONSUMER_CPU); }).detach();
+    std::thread([lBoostLockFree] { return boostLockFreeProducer(lBoostLockFree, PRODUCER_CPU); }).detach();
+
+    // Wait for the OS to actually get it done.
+    std::this_thread::sleep_for(std::chrono::milliseconds(10));
+
+    // Start the test
+    std::cout << "BoostLockFree pointer test started." << std::endl;
+    gStartBench = true;
+    std::this_thread::sleep_for(std::chrono::seconds(TEST_TIME_DURATION_SEC));
+
+    // End the test
+    gActiveProducer = false;
+    std::cout << "BoostLockFree pointer test ended." << std::endl;
+
+    // Wait for the consumers to 'join'
+    // Why not the classic join? I prepared for a multi thread case I need this function for.
+    while (gActiveConsumer) {
+        std::this_thread::sleep_for(std::chrono::milliseconds(1));
+    }
+
+    // Garbage collect the queue
+    delete lBoostLockFree;
+
+    // Print the result.
+    std::cout << "BoostLockFree Transactions -> " << gCounter / TEST_TIME_DURATION_SEC << "/s" << std::endl;
+
+    // Zero the test parameters.
+    gStartBench = false;
+    gActiveProducer = true;
+    gCounter = 0;
+    gActiveConsumer = 0;
+
+    ///
     /// FastQueue test ->
     ///
 
     // Create the queue
-    auto lFastQueue = new FastQueue<MyObject *, QUEUE_MASK, L1_CACHE_LINE>();
+    auto lFastQueue = new FastQueue<MyObject *, QUEUE_MASK, L1_CACHE_LINE>();
+
+    // Start the consumer(s) / Producer(s)
+    gActiveConsumer++;
+    std::thread([lFastQueue] { return fastQueueConsumer(lFastQueue, CONSUMER_CPU); }).detach();
+    std::thread([lFastQueue] { return fastQueueProducer(lFastQueue, PRODUCER_CPU); }).detach();
+
+    // Wait for the OS to actually get it done.
+    std::this_thread::sleep_for(std::chrono::milliseconds(10));
+
+    // Start the test
+    std::cout << "FastQueue pointer test started." << std::endl;
+    gStartBench = true;
+    std::this_thread::sleep_for(std::chrono::seconds(TEST_TIME_DURATION_SEC));
+
+    // End the test
+    gActiveProducer = false;
+    std::cout << "FastQueue pointer test ended." << std::endl;
+
+    // Wait for the consumers to 'join'
+    // Why not the classic join? I prepared for a multi thread case I need this function for.
+    while (gActiveConsumer) {
+        std::this_thread::sleep_for(std::chrono::milliseconds(1));
+    }
+
+    // Garbage collect the queue
+    delete lFastQueue;
+
+    // Print the result.
+    uint64_t lFastQueueResult = gCounter / TEST_TIME_DURATION_SEC;
+    std::cout << "FastQueue Transactions -> " << gCounter / TEST_TIME_DURATION_SEC << "/s" << std::endl;
+
+    // Zero the test parameters.
+    gStartBench = false;
+    gActiveProducer = true;
+    gCounter = 0;
+    gActiveConsumer = 0;
+
+    ///
+    /// FastQueueUncached test ->
+    ///
+
+    // Same queue reading the other sides position on every full/empty check
+    auto lFastQueueUncached = new FastQueue<MyObject *, QUEUE_MASK, L1_CACHE_LINE, FastQueueLayout::PADDED,
+            FastQueueWaitBusy, FastQueueBarrierFence, FastQueueNoStats, FastQueuePositions::UNCACHED>();
+
+    // Start the consumer(s) / Producer(s)
+    gActiveConsumer++;
+    std::thread([lFastQueueUncached] { return fastQueueConsumer(lFastQueueUncached, CONSUMER_CPU); }).detach();
+    std::thread([lFastQueueUncached] { return fastQueueProducer(lFastQueueUncached, PRODUCER_CPU); }).detach();
+
+    // Wait for the OS to actually get it done.
+    std::this_thread::sleep_for(std::chrono::milliseconds(10));
+
+    // Start the test
+    std::cout << "FastQueueUncached pointer test started." << std::endl;
+    gStartBench = true;
+    std::this_thread::sleep_for(std::chrono::seconds(TEST_TIME_DURATION_SEC));
+
+    // End the test
+    gActiveProducer = false;
+    std::cout << "FastQueueUncached pointer test ended." << std::endl;
+
+    // Wait for the consumers to 'join'
+    // Why not the classic join? I prepared for a multi thread case I need this function for.
+    while (gActiveConsumer) {
+        std::this_thread::sleep_for(std::chrono::milliseconds(1));
+    }
+
+    // Garbage collect the queue
+    delete lFastQueueUncached;
+
+    // Print the result.
+    uint64_t lFastQueueUncachedResult = gCounter / TEST_TIME_DURATION_SEC;
+    std::cout << "FastQueueUncached Transactions -> " << gCounter / TEST_TIME_DURATION_SEC << "/s" << std::endl;
+
+    // Zero the test parameters.
+    gStartBench = false;
+    gActiveProducer = true;
+    gCounter = 0;
+    gActiveConsumer = 0;
+
+    ///
+    /// Erik Rigtorp SPSC test ->
+    ///
+
+    // Create the queue
+    auto lRigtorpSPSCQueue = new rigtorp::SPSCQueue<MyObject *>(QUEUE_MASK);
+
+    // Start the consumer(s) / Producer(s)
+    gActiveConsumer++;
+    std::thread([lRigtorpSPSCQueue] { return rigtorpQueueConsumer(lRigtorpSPSCQueue, CONSUMER_CPU); }).detach();
+    std::thread([lRigtorpSPSCQueue] { return rigtorpQueueProducer(lRigtorpSPSCQueue, PRODUCER_CPU); }).detach();
+
+    // Wait for the OS to actually get it done.
+    std::this_thread::sleep_for(std::chrono::milliseconds(10));
+
+    // Start the test
+    std::cout << "Rigtorp pointer test started." << std::endl;
+    gStartBench = true;
+    std::this_thread::sleep_for(std::chrono::seconds(TEST_TIME_DURATION_SEC));
+
+
+    // End the test
+    gActiveProducer = false;
+    std::cout << "Rigtorp pointer test ended." << std::endl;
+
+    // Wait for the consumers to 'join'
+    // Why not the classic join? I prepared for a multi thread case I need this function for.
+    while (gActiveConsumer) {
+        std::this_thread::sleep_for(std::chrono::milliseconds(1));
+    }
+
+    // Garbage collect the queue
+    delete lRigtorpSPSCQueue;
+
+    // Print the result.
+    std::cout << "Rigtorp Transactions -> " << gCounter / TEST_TIME_DURATION_SEC << "/s" << std::endl;
+
+    // Zero the test parameters.
+    gStartBench = false;
+    gActiveProducer = true;
+    gCounter = 0;
+    gActiveConsumer = 0;
+
+    ///
+    /// FastQueueASM test ->
+    ///
+
+    // Create the queue
+    auto pQueue = FastQueueASM::newQueue(QUEUE_MASK);
+
+    // Start the consumer(s) / Producer(s)
+    gActiveConsumer++;
+
+    std::thread([pQueue] { fastQueueASMConsumer(pQueue, CONSUMER_CPU); }).detach();
+    std::thread([pQueue] { fastQueueASMProducer(pQueue, PRODUCER_CPU); }).detach();
+
+    // Wait for the OS to actually get it done.
+    std::this_thread::sleep_for(std::chrono::milliseconds(100));
+
+    // Start the test
+    std::cout << "FastQueueASM pointer test started." << std::endl;
+    gStartBench = true;
+    std::this_thread::sleep_for(std::chrono::seconds(TEST_TIME_DURATION_SEC));
+
+    // End the test
+    gActiveProducer = false;
+    std::cout << "FastQueueASM pointer test ended." << std::endl;
+
+    // Wait for the consumers to 'join'
+    // Why not the classic join? I prepared for a multi thread case I need this function for.
+    while (gActiveConsumer) {
+        std::this_thread::sleep_for(std::chrono::milliseconds(1));
+    }
+
+    // Garbage collect the queue
+    deleteQueue(pQueue);
+
+    // Print the result.
+    uint64_t lFastQueueASMResult = gCounter / TEST_TIME_DURATION_SEC;
+    std::cout << "FastQueueASM Transactions -> " << gCounter / TEST_TIME_DURATION_SEC << "/s" << std::endl;
+
+    // Zero the test parameters.
+    gStartBench = false;
+    gActiveProducer = true;
+    gCounter = 0;
+    gActiveConsumer = 0;
+
+    ///
+    /// FastQueueASMTry test ->
+    ///
+
+    // Create the queue
+    pQueue = FastQueueASM::newQueue(QUEUE_MASK);
+
+    // Start the consumer(s) / Producer(s)
+    gActiveConsumer++;
+
+    std::thread([pQueue] { fastQueueASMConsumerTry(pQueue, CONSUMER_CPU); }).detach();
+    std::thread([pQueue] { fastQueueASMProducerTry(pQueue, PRODUCER_CPU); }).detach();
+
+    // Wait for the OS to actually get it done.
+    std::this_thread::sleep_for(std::chrono::milliseconds(100));
+
+    // Start the test
+    std::cout << "FastQueueASMTry pointer test started." << std::endl;
+    gStartBench = true;
+    std::this_thread::sleep_for(std::chrono::seconds(TEST_TIME_DURATION_SEC));
+
+    // End the test
+    gActiveProducer = false;
+    std::cout << "FastQueueASMTry pointer test ended." << std::endl;
+
+    // Wait for the consumers to 'join'
+    // Why not the classic join? I prepared for a multi thread case I need this function for.
+    while (gActiveConsumer) {
+        std::this_thread::sleep_for(std::chrono::milliseconds(1));
+    }
+
+    // Garbage collect the queue
+    deleteQueue(pQueue);
+
+    // Print the result.
+    uint64_t lFastQueueASMTryResult = gCounter / TEST_TIME_DURATION_SEC;
+    std::cout << "FastQueueASMTry Transactions -> " << gCounter / TEST_TIME_DURATION_SEC << "/s" << std::endl;
+
+    // Zero the test parameters.
+    gStartBench = false;
+    gActiveProducer = true;
+    gCounter = 0;
+    gActiveConsumer = 0;
+
+    ///
+    /// FastQueueASMBulk test ->
+    ///
+
+    // Create the queue
+    pQueue = FastQueueASM::newQueue(QUEUE_MASK);
+
+    // Start the consumer(s) / Producer(s)
+    gActiveConsumer++;
+
+    std::thread([pQueue] { fastQueueASMConsumerBulk(pQueue, CONSUMER_CPU); }).detach();
+    std::thread([pQueue] { fastQueueASMProducerBulk(pQueue, PRODUCER_CPU); }).detach();
+
+    // Wait for the OS to actually get it done.
+    std::this_thread::sleep_for(std::chrono::milliseconds(100));
+
+    // Start the test
+    std::cout << "FastQueueASMBulk pointer test started." << std::endl;
+    gStartBench = true;
+    std::this_thread::sleep_for(std::chrono::seconds(TEST_TIME_DURATION_SEC));
+
+    // End the test
+    gActiveProducer = false;
+    std::cout << "FastQueueASMBulk pointer test ended." << std::endl;
+
+    // Wait for the consumers to 'join'
+    // Why not the classic join? I prepared for a multi thread case I need this function for.
+    while (gActiveConsumer) {
+        std::this_thread::sleep_for(std::chrono::milliseconds(1));
+    }
+
+    // Garbage collect the queue
+    deleteQueue(pQueue);
+
+    // Print the result.
+    uint64_t lFastQueueASMBulkResult = gCounter / TEST_TIME_DURATION_SEC;
+    std::cout << "FastQueueASMBulk Transactions -> " << gCounter / TEST_TIME_DURATION_SEC << "/s" << std::endl;
+
+#if __aarch64__ || _M_ARM64
+    // Zero the test parameters.
+    gStartBench = false;
+    gActiveProducer = true;
+    gCounter = 0;
+    gActiveConsumer = 0;
+
+    ///
+    /// FastQueueASMAcqRel test ->
+    ///
+
+    // Create the queue
+    pQueue = FastQueueASM::newQueue(QUEUE_MASK);
+
+    // stlr/ldapr if the CPU has RCpc else stlr/ldar
+    auto pPush = FastQueueASM::pushItemAcqRel();
+    auto pPop = FastQueueASM::popItemAcqRel();
+
+    // Start the consumer(s) / Producer(s)
+    gActiveConsumer++;
+
+    std::thread([pQueue, pPop] { fastQueueASMConsumer(pQueue, CONSUMER_CPU, pPop); }).detach();
+    std::thread([pQueue, pPush] { fastQueueASMProducer(pQueue, PRODUCER_CPU, pPush); }).detach();
+
+    // Wait for the OS to actually get it done.
+    std::this_thread::sleep_for(std::chrono::milliseconds(100));
+
+    // Start the test
+    std::cout << "FastQueueASMAcqRel (" << (FastQueueASM::hasLrcpc() ? "ldapr" : "ldar")
+              << ") pointer test started." << std::endl;
+    gStartBench = true;
+    std::this_thread::sleep_for(std::chrono::seconds(TEST_TIME_DURATION_SEC));
+
+    // End the test
+    gActiveProducer = false;
+    std::cout << "FastQueueASMAcqRel pointer test ended." << std::endl;
+
+    // Wait for the consumers to 'join'
+    // Why not the classic join? I prepared for a multi thread case I need this function for.
+    while (gActiveConsumer) {
+        std::this_thread::sleep_for(std::chrono::milliseconds(1));
+    }
+
+    // Garbage collect the queue
+    deleteQueue(pQueue);
+
+    // Print the result.
+    uint64_t lFastQueueASMAcqRelResult = gCounter / TEST_TIME_DURATION_SEC;
+    std::cout << "FastQueueASMAcqRel Transactions -> " << gCounter / TEST_TIME_DURATION_SEC << "/s" << std::endl;
+#endif
+
+    // Zero the test parameters.
+    gStartBench = false;
+    gActiveProducer = true;
+    gCounter = 0;
+    gActiveConsumer = 0;
+
+    ///
+    /// DeaodSPSC test ->
+    ///
+
+    // Create the queue
+    auto deaodSPSC = new deaod::spsc_queue<MyObject *, QUEUE_MASK, 6>();
+
+    // Start the consumer(s) / Producer(s)
+    gActiveConsumer++;
+
+    std::thread([deaodSPSC] { deaodSPSCConsumer(deaodSPSC, CONSUMER_CPU); }).detach();
+    std::thread([deaodSPSC] { deaodSPSCProducer(deaodSPSC, PRODUCER_CPU); }).detach();
+
+    // Wait for the OS to actually get it done.
+    std::this_thread::sleep_for(std::chrono::milliseconds(100));
+
+    // Start the test
+    std::cout << "DeaodSPSC pointer test started." << std::endl;
+    gStartBench = true;
+    std::this_thread::sleep_for(std::chrono::seconds(TEST_TIME_DURATION_SEC));
+
+    // End the test
+    gActiveProducer = false;
+    std::cout << "DeaodSPSC pointer test ended." << std::endl;
+
+    // Wait for the consumers to 'join'
+    // Why not the classic join? I prepared for a multi thread case I need this function for.
+    while (gActiveConsumer) {
+        std::this_thread::sleep_for(std::chrono::milliseconds(1));
+    }
+
+    // Garbage collect the queue
+    delete deaodSPSC;
+
+    // Print the result.
+    uint64_t lDeaodSPSCResult = gCounter / TEST_TIME_DURATION_SEC;
+    std::cout << "DeaodSPSC Transactions -> " << gCounter / TEST_TIME_DURATION_SEC << "/s" << std::endl;
+
+    // Zero the test parameters.
+    gStartBench = false;
+    gActiveProducer = true;
+    gCounter = 0;
+    gActiveConsumer = 0;
+
+    ///
+    /// FastQueueRaw test ->
+    ///
+
+    // Create the queue
+    auto lFastQueueRaw = new FastQueue<MyObject *, QUEUE_MASK, L1_CACHE_LINE>();
+
+    // Start the consumer(s) / Producer(s)
+    gActiveConsumer++;
+    std::thread([lFastQueueRaw] { return fastQueueConsumerRaw(lFastQueueRaw, CONSUMER_CPU); }).detach();
+    std::thread([lFastQueueRaw] { return fastQueueProducerRaw(lFastQueueRaw, PRODUCER_CPU); }).detach();
+
+    // Wait for the OS to actually get it done.
+    std::this_thread::sleep_for(std::chrono::milliseconds(10));
+
+    // Start the test
+    std::cout << "FastQueueRaw pointer test started." << std::endl;
+    gStartBench = true;
+    std::this_thread::sleep_for(std::chrono::seconds(TEST_TIME_DURATION_SEC));
+
+    // End the test
+    gActiveProducer = false;
+    std::cout << "FastQueueRaw pointer test ended." << std::endl;
+
+    // Wait for the consumers to 'join'
+    // Why not the classic join? I prepared for a multi thread case I need this function for.
+    while (gActiveConsumer) {
+        std::this_thread::sleep_for(std::chrono::milliseconds(1));
+    }
+
+    // Garbage collect the queue
+    delete lFastQueueRaw;
+
+    // Print the result.
+    std::cout << "FastQueueRaw Transactions -> " << gCounter / TEST_TIME_DURATION_SEC << "/s" << std::endl;
+
+    // Zero the test parameters.
+    gStartBench = false;
+    gActiveProducer = true;
+    gCounter = 0;
+    gActiveConsumer = 0;
+
+    ///
+    /// FastQueueBulk test ->
+    ///
+
+    // Create the queue
+    auto lFastQueueBulk = new FastQueue<MyObject *, QUEUE_MASK, L1_CACHE_LINE>();
+
+    // Start the consumer(s) / Producer(s)
+    gActiveConsumer++;
+    std::thread([lFastQueueBulk] { return fastQueueConsumerBulk(lFastQueueBulk, CONSUMER_CPU); }).detach();
+    std::thread([lFastQueueBulk] { return fastQueueProducerBulk(lFastQueueBulk, PRODUCER_CPU); }).detach();
+
+    // Wait for the OS to actually get it done.
+    std::this_thread::sleep_for(std::chrono::milliseconds(10));
+
+    // Start the test
+    std::cout << "FastQueueBulk pointer test started." << std::endl;
+    gStartBench = true;
+    std::this_thread::sleep_for(std::chrono::seconds(TEST_TIME_DURATION_SEC));
+
+    // End the test
+    gActiveProducer = false;
+    std::cout << "FastQueueBulk pointer test ended." << std::endl;
+
+    // Wait for the consumers to 'join'
+    // Why not the classic join? I prepared for a multi thread case I need this function for.
+    while (gActiveConsumer) {
+        std::this_thread::sleep_for(std::chrono::milliseconds(1));
+    }
+
+    // Garbage collect the queue
+    delete lFastQueueBulk;
+
+    // Print the result.
+    std::cout << "FastQueueBulk Transactions -> " << gCounter / TEST_TIME_DURATION_SEC << "/s" << std::endl;
+
+    // Zero the test parameters.
+    gStartBench = false;
+    gActiveProducer = true;
+    gCounter = 0;
+    gActiveConsumer = 0;
+
+    ///
+    /// FastQueueDense test ->
+    ///
+
+    // Create the queue
+    auto lFastQueueDense = new FastQueue<MyObject *, QUEUE_MASK, L1_CACHE_LINE, FastQueueLayout::DENSE>();
+
+    // Start the consumer(s) / Producer(s)
+    gActiveConsumer++;
+    std::thread([lFastQueueDense] { return fastQueueConsumer(lFastQueueDense, CONSUMER_CPU); }).detach();
+    std::thread([lFastQueueDense] { return fastQueueProducer(lFastQueueDense, PRODUCER_CPU); }).detach();
+
+    // Wait for the OS to actually get it done.
+    std::this_thread::sleep_for(std::chrono::milliseconds(10));
+
+    // Start the test
+    std::cout << "FastQueueDense pointer test started." << std::endl;
+    gStartBench = true;
+    std::this_thread::sleep_for(std::chrono::seconds(TEST_TIME_DURATION_SEC));
+
+    // End the test
+    gActiveProducer = false;
+    std::cout << "FastQueueDense pointer test ended." << std::endl;
+
+    // Wait for the consumers to 'join'
+    // Why not the classic join? I prepared for a multi thread case I need this function for.
+    while (gActiveConsumer) {
+        std::this_thread::sleep_for(std::chrono::milliseconds(1));
+    }
+
+    // Garbage collect the queue
+    delete lFastQueueDense;
+
+    // Print the result.
+    std::cout << "FastQueueDense Transactions -> " << gCounter / TEST_TIME_DURATION_SEC << "/s" << std::endl;
+
+    // Zero the test parameters.
+    gStartBench = false;
+    gActiveProducer = true;
+    gCounter = 0;
+    gActiveConsumer = 0;
+
+    ///
+    /// FastQueuePaddedDeep test ->
+    ///
+
+    // Create the queue
+    auto lFastQueuePaddedDeep = new FastQueue<MyObject *, DEEP_QUEUE_MASK, L1_CACHE_LINE, FastQueueLayout::PADDED>();
+
+    // Start the consumer(s) / Producer(s)
+    gActiveConsumer++;
+    std::thread([lFastQueuePaddedDeep] { return fastQueueConsumer(lFastQueuePaddedDeep, CONSUMER_CPU); }).detach();
+    std::thread([lFastQueuePaddedDeep] { return fastQueueProducer(lFastQueuePaddedDeep, PRODUCER_CPU); }).detach();
+
+    // Wait for the OS to actually get it done.
+    std::this_thread::sleep_for(std::chrono::milliseconds(10));
+
+    // Start the test
+    std::cout << "FastQueuePaddedDeep pointer test started." << std::endl;
+    gStartBench = true;
+    std::this_thread::sleep_for(std::chrono::seconds(TEST_TIME_DURATION_SEC));
+
+    // End the test
+    gActiveProducer = false;
+    std::cout << "FastQueuePaddedDeep pointer test ended." << std::endl;
+
+    // Wait for the consumers to 'join'
+    // Why not the classic join? I prepared for a multi thread case I need this function for.
+    while (gActiveConsumer) {
+        std::this_thread::sleep_for(std::chrono::milliseconds(1));
+    }
+
+    // Garbage collect the queue
+    delete lFastQueuePaddedDeep;
+
+    // Print the result.
+    std::cout << "FastQueuePaddedDeep Transactions -> " << gCounter / TEST_TIME_DURATION_SEC << "/s" << std::endl;
+
+    // Zero the test parameters.
+    gStartBench = false;
+    gActiveProducer = true;
+    gCounter = 0;
+    gActiveConsumer = 0;
+
+    ///
+    /// FastQueueDenseDeep test ->
+    ///
+
+    // Create the queue
+    auto lFastQueueDenseDeep = new FastQueue<MyObject *, DEEP_QUEUE_MASK, L1_CACHE_LINE, FastQueueLayout::DENSE>();
+
+    // Start the consumer(s) / Producer(s)
+    gActiveConsumer++;
+    std::thread([lFastQueueDenseDeep] { return fastQueueConsumer(lFastQueueDenseDeep, CONSUMER_CPU); }).detach();
+    std::thread([lFastQueueDenseDeep] { return fastQueueProducer(lFastQueueDenseDeep, PRODUCER_CPU); }).detach();
+
+    // Wait for the OS to actually get it done.
+    std::this_thread::sleep_for(std::chrono::milliseconds(10));
+
+    // Start the test
+    std::cout << "FastQueueDenseDeep pointer test started." << std::endl;
+    gStartBench = true;
+    std::this_thread::sleep_for(std::chrono::seconds(TEST_TIME_DURATION_SEC));
+
+    // End the test
+    gActiveProducer = false;
+    std::cout << "FastQueueDenseDeep pointer test ended." << std::endl;
+
+    // Wait for the consumers to 'join'
+    // Why not the classic join? I prepared for a multi thread case I need this function for.
+    while (gActiveConsumer) {
+        std::this_thread::sleep_for(std::chrono::milliseconds(1));
+    }
+
+    // Garbage collect the queue
+    delete lFastQueueDenseDeep;
+
+    // Print the result.
+    std::cout << "FastQueueDenseDeep Transactions -> " << gCounter / TEST_TIME_DURATION_SEC << "/s" << std::endl;
+
+    // Zero the test parameters.
+    gStartBench = false;
+    gActiveProducer = true;
+    gCounter = 0;
+    gActiveConsumer = 0;
+
+    ///
+    /// FastQueueHugePagesDeep test ->
+    ///
+
+    // Create the queue
+    auto lFastQueueHugePagesDeep = new FastQueue<MyObject *, 0, L1_CACHE_LINE>(DEEP_QUEUE_MASK, FastQueueMemory::HUGE_PAGES);
 
     // Start the consumer(s) / Producer(s)
     gActiveConsumer++;
-    std::thread([lFastQueue] { return fastQueueConsumer(lFastQueue, CONSUMER_CPU); }).detach();
-    std::thread([lFastQueue] { return fastQueueProducer(lFastQueue, PRODUCER_CPU); }).detach();
+    std::thread([lFastQueueHugePagesDeep] { return fastQueueConsumer(lFastQueueHugePagesDeep, CONSUMER_CPU); }).detach();
+    std::thread([lFastQueueHugePagesDeep] { return fastQueueProducer(lFastQueueHugePagesDeep, PRODUCER_CPU); }).detach();
 
     // Wait for the OS to actually get it done.
     std::this_thread::sleep_for(std::chrono::milliseconds(10));
 
     // Start the test
-    std::cout << "FastQueue pointer test started." << std::endl;
+    std::cout << "FastQueueHugePagesDeep pointer test started." << std::endl;
     gStartBench = true;
     std::this_thread::sleep_for(std::chrono::seconds(TEST_TIME_DURATION_SEC));
 
     // End the test
     gActiveProducer = false;
-    std::cout << "FastQueue pointer test ended." << std::endl;
+    std::cout << "FastQueueHugePagesDeep pointer test ended." << std::endl;
 
     // Wait for the consumers to 'join'
     // Why not the classic join? I prepared for a multi thread case I need this function for.
@@ -461,10 +3144,10 @@ int main() {
     }
 
     // Garbage collect the queue
-    delete lFastQueue;
+    delete lFastQueueHugePagesDeep;
 
     // Print the result.
-    std::cout << "FastQueue Transactions -> " << gCounter / TEST_TIME_DURATION_SEC << "/s" << std::endl;
+    std::cout << "FastQueueHugePagesDeep Transactions -> " << gCounter / TEST_TIME_DURATION_SEC << "/s" << std::endl;
 
     // Zero the test parameters.
     gStartBench = false;
@@ -473,29 +3156,70 @@ int main() {
     gActiveConsumer = 0;
 
     ///
-    /// Erik Rigtorp SPSC test ->
+    /// FastQueueMessage test ->
     ///
 
     // Create the queue
-    auto lRigtorpSPSCQueue = new rigtorp::SPSCQueue<MyObject *>(QUEUE_MASK);
+    auto lFastQueueMessage = new FastQueue<MyMessage, QUEUE_MASK, L1_CACHE_LINE>();
 
     // Start the consumer(s) / Producer(s)
     gActiveConsumer++;
-    std::thread([lRigtorpSPSCQueue] { return rigtorpQueueConsumer(lRigtorpSPSCQueue, CONSUMER_CPU); }).detach();
-    std::thread([lRigtorpSPSCQueue] { return rigtorpQueueProducer(lRigtorpSPSCQueue, PRODUCER_CPU); }).detach();
+    std::thread([lFastQueueMessage] { return fastQueueConsumerMessage(lFastQueueMessage, CONSUMER_CPU); }).detach();
+    std::thread([lFastQueueMessage] { return fastQueueProducerMessage(lFastQueueMessage, PRODUCER_CPU); }).detach();
 
     // Wait for the OS to actually get it done.
     std::this_thread::sleep_for(std::chrono::milliseconds(10));
 
     // Start the test
-    std::cout << "Rigtorp pointer test started." << std::endl;
+    std::cout << "FastQueueMessage message test started." << std::endl;
     gStartBench = true;
     std::this_thread::sleep_for(std::chrono::seconds(TEST_TIME_DURATION_SEC));
 
+    // End the test
+    gActiveProducer = false;
+    std::cout << "FastQueueMessage message test ended." << std::endl;
+
+    // Wait for the consumers to 'join'
+    // Why not the classic join? I prepared for a multi thread case I need this function for.
+    while (gActiveConsumer) {
+        std::this_thread::sleep_for(std::chrono::milliseconds(1));
+    }
+
+    // Garbage collect the queue
+    delete lFastQueueMessage;
+
+    // Print the result.
+    std::cout << "FastQueueMessage Transactions -> " << gCounter / TEST_TIME_DURATION_SEC << "/s" << std::endl;
+
+    // Zero the test parameters.
+    gStartBench = false;
+    gActiveProducer = true;
+    gCounter = 0;
+    gActiveConsumer = 0;
+
+    ///
+    /// FastQueueInPlace test ->
+    ///
+
+    // Create the queue
+    auto lFastQueueInPlace = new FastQueue<MyMessage, QUEUE_MASK, L1_CACHE_LINE>();
+
+    // Start the consumer(s) / Producer(s)
+    gActiveConsumer++;
+    std::thread([lFastQueueInPlace] { return fastQueueConsumerInPlace(lFastQueueInPlace, CONSUMER_CPU); }).detach();
+    std::thread([lFastQueueInPlace] { return fastQueueProducerInPlace(lFastQueueInPlace, PRODUCER_CPU); }).detach();
+
+    // Wait for the OS to actually get it done.
+    std::this_thread::sleep_for(std::chrono::milliseconds(10));
+
+    // Start the test
+    std::cout << "FastQueueInPlace message test started." << std::endl;
+    gStartBench = true;
+    std::this_thread::sleep_for(std::chrono::seconds(TEST_TIME_DURATION_SEC));
 
     // End the test
     gActiveProducer = false;
-    std::cout << "Rigtorp pointer test ended." << std::endl;
+    std::cout << "FastQueueInPlace message test ended." << std::endl;
 
     // Wait for the consumers to 'join'
     // Why not the classic join? I prepared for a multi thread case I need this function for.
@@ -504,10 +3228,10 @@ int main() {
     }
 
     // Garbage collect the queue
-    delete lRigtorpSPSCQueue;
+    delete lFastQueueInPlace;
 
     // Print the result.
-    std::cout << "Rigtorp Transactions -> " << gCounter / TEST_TIME_DURATION_SEC << "/s" << std::endl;
+    std::cout << "FastQueueInPlace Transactions -> " << gCounter / TEST_TIME_DURATION_SEC << "/s" << std::endl;
 
     // Zero the test parameters.
     gStartBench = false;
@@ -516,29 +3240,70 @@ int main() {
     gActiveConsumer = 0;
 
     ///
-    /// FastQueueASM test ->
+    /// FastQueuePause test ->
     ///
 
     // Create the queue
-    auto pQueue = FastQueueASM::newQueue();
+    auto lFastQueuePause = new FastQueue<MyObject *, QUEUE_MASK, L1_CACHE_LINE, FastQueueLayout::PADDED, FastQueueWaitPause>();
 
     // Start the consumer(s) / Producer(s)
     gActiveConsumer++;
+    std::thread([lFastQueuePause] { return fastQueueConsumer(lFastQueuePause, CONSUMER_CPU); }).detach();
+    std::thread([lFastQueuePause] { return fastQueueProducer(lFastQueuePause, PRODUCER_CPU); }).detach();
 
-    std::thread([pQueue] { fastQueueASMConsumer(pQueue, CONSUMER_CPU); }).detach();
-    std::thread([pQueue] { fastQueueASMProducer(pQueue, PRODUCER_CPU); }).detach();
+    // Wait for the OS to actually get it done.
+    std::this_thread::sleep_for(std::chrono::milliseconds(10));
+
+    // Start the test
+    std::cout << "FastQueuePause pointer test started." << std::endl;
+    gStartBench = true;
+    std::this_thread::sleep_for(std::chrono::seconds(TEST_TIME_DURATION_SEC));
+
+    // End the test
+    gActiveProducer = false;
+    std::cout << "FastQueuePause pointer test ended." << std::endl;
+
+    // Wait for the consumers to 'join'
+    // Why not the classic join? I prepared for a multi thread case I need this function for.
+    while (gActiveConsumer) {
+        std::this_thread::sleep_for(std::chrono::milliseconds(1));
+    }
+
+    // Garbage collect the queue
+    delete lFastQueuePause;
+
+    // Print the result.
+    std::cout << "FastQueuePause Transactions -> " << gCounter / TEST_TIME_DURATION_SEC << "/s" << std::endl;
+
+    // Zero the test parameters.
+    gStartBench = false;
+    gActiveProducer = true;
+    gCounter = 0;
+    gActiveConsumer = 0;
+
+    ///
+    /// FastQueueBackoff test ->
+    ///
+
+    // Create the queue
+    auto lFastQueueBackoff = new FastQueue<MyObject *, QUEUE_MASK, L1_CACHE_LINE, FastQueueLayout::PADDED, FastQueueWaitBackoff<>>();
+
+    // Start the consumer(s) / Producer(s)
+    gActiveConsumer++;
+    std::thread([lFastQueueBackoff] { return fastQueueConsumer(lFastQueueBackoff, CONSUMER_CPU); }).detach();
+    std::thread([lFastQueueBackoff] { return fastQueueProducer(lFastQueueBackoff, PRODUCER_CPU); }).detach();
 
     // Wait for the OS to actually get it done.
-    std::this_thread::sleep_for(std::chrono::milliseconds(100));
+    std::this_thread::sleep_for(std::chrono::milliseconds(10));
 
     // Start the test
-    std::cout << "FastQueueASM pointer test started." << std::endl;
+    std::cout << "FastQueueBackoff pointer test started." << std::endl;
     gStartBench = true;
     std::this_thread::sleep_for(std::chrono::seconds(TEST_TIME_DURATION_SEC));
 
     // End the test
     gActiveProducer = false;
-    std::cout << "FastQueueASM pointer test ended." << std::endl;
+    std::cout << "FastQueueBackoff pointer test ended." << std::endl;
 
     // Wait for the consumers to 'join'
     // Why not the classic join? I prepared for a multi thread case I need this function for.
@@ -547,10 +3312,10 @@ int main() {
     }
 
     // Garbage collect the queue
-    deleteQueue(pQueue);
+    delete lFastQueueBackoff;
 
     // Print the result.
-    std::cout << "FastQueueASM Transactions -> " << gCounter / TEST_TIME_DURATION_SEC << "/s" << std::endl;
+    std::cout << "FastQueueBackoff Transactions -> " << gCounter / TEST_TIME_DURATION_SEC << "/s" << std::endl;
 
     // Zero the test parameters.
     gStartBench = false;
@@ -559,29 +3324,137 @@ int main() {
     gActiveConsumer = 0;
 
     ///
-    /// DeaodSPSC test ->
+    /// FastQueueSleep test ->
     ///
 
     // Create the queue
-    auto deaodSPSC = new deaod::spsc_queue<MyObject *, QUEUE_MASK, 6>();
+    auto lFastQueueSleep = new FastQueue<MyObject *, QUEUE_MASK, L1_CACHE_LINE, FastQueueLayout::PADDED, FastQueueWaitSleep<>>();
 
     // Start the consumer(s) / Producer(s)
     gActiveConsumer++;
+    std::thread([lFastQueueSleep] { return fastQueueConsumer(lFastQueueSleep, CONSUMER_CPU); }).detach();
+    std::thread([lFastQueueSleep] { return fastQueueProducer(lFastQueueSleep, PRODUCER_CPU); }).detach();
 
-    std::thread([deaodSPSC] { deaodSPSCConsumer(deaodSPSC, CONSUMER_CPU); }).detach();
-    std::thread([deaodSPSC] { deaodSPSCProducer(deaodSPSC, PRODUCER_CPU); }).detach();
+    // Wait for the OS to actually get it done.
+    std::this_thread::sleep_for(std::chrono::milliseconds(10));
+
+    // Start the test
+    std::cout << "FastQueueSleep pointer test started." << std::endl;
+    gStartBench = true;
+    std::this_thread::sleep_for(std::chrono::seconds(TEST_TIME_DURATION_SEC));
+
+    // End the test
+    gActiveProducer = false;
+    std::cout << "FastQueueSleep pointer test ended." << std::endl;
+
+    // Wait for the consumers to 'join'
+    // Why not the classic join? I prepared for a multi thread case I need this function for.
+    while (gActiveConsumer) {
+        std::this_thread::sleep_for(std::chrono::milliseconds(1));
+    }
+
+    // Garbage collect the queue
+    delete lFastQueueSleep;
+
+    // Print the result.
+    std::cout << "FastQueueSleep Transactions -> " << gCounter / TEST_TIME_DURATION_SEC << "/s" << std::endl;
+
+    ///
+    /// Barrier ablation tests ->
+    ///
+
+    barrierAblationTest<FastQueue<MyObject *, QUEUE_MASK, L1_CACHE_LINE, FastQueueLayout::PADDED,
+            FastQueueWaitBusy, FastQueueBarrierFence>>("FastQueueBarrierFence");
+    barrierAblationTest<FastQueue<MyObject *, QUEUE_MASK, L1_CACHE_LINE, FastQueueLayout::PADDED,
+            FastQueueWaitBusy, FastQueueBarrierAtomic>>("FastQueueBarrierAtomic");
+    barrierAblationTest<FastQueue<MyObject *, QUEUE_MASK, L1_CACHE_LINE, FastQueueLayout::PADDED,
+            FastQueueWaitBusy, FastQueueBarrierMinimal>>("FastQueueBarrierMinimal");
+
+    ///
+    /// Stats test ->
+    ///
+
+    statsTest();
+    latencyStatsTest();
+    numaPlacementTest();
+
+    ///
+    /// Wake-up latency tests ->
+    ///
+
+    wakeLatencyTest<FastQueue<MyTimedMessage, QUEUE_MASK, L1_CACHE_LINE>>("FastQueue");
+    wakeLatencyTest<FastQueue<MyTimedMessage, QUEUE_MASK, L1_CACHE_LINE, FastQueueLayout::PADDED,
+            FastQueueWaitSleep<>>>("FastQueueSleep");
+    wakeLatencyTest<FastQueue<MyTimedMessage, QUEUE_MASK, L1_CACHE_LINE, FastQueueLayout::PADDED,
+            FastQueueWaitPause>>("FastQueuePause");
+    wakeLatencyTest<FastQueue<MyTimedMessage, QUEUE_MASK, L1_CACHE_LINE, FastQueueLayout::PADDED,
+            FastQueueWaitFutex<>>>("FastQueueFutex");
+    // UMWAIT where CPUID reports WAITPKG else pause (x86), wfe (arm64)
+#if __aarch64__ || _M_ARM64
+    std::cout << "FastQueueMonitor waits with wfe" << std::endl;
+#else
+    std::cout << "FastQueueMonitor waits with " << (fastQueueHasWaitPkg() ? "UMWAIT" : "pause (no WAITPKG)")
+              << std::endl;
+#endif
+    wakeLatencyTest<FastQueue<MyTimedMessage, QUEUE_MASK, L1_CACHE_LINE, FastQueueLayout::PADDED,
+            FastQueueWaitMonitor<>>>("FastQueueMonitor");
+    wakeLatencyTest<WakeLatencyASM<false>>("FastQueueASM");
+    wakeLatencyTest<WakeLatencyASM<true>>("FastQueueASMWait");
+
+    ///
+    /// FanInQueue scaling tests ->
+    ///
+
+    for (uint64_t lProducers = 1; lProducers <= FAN_IN_LANES; lProducers *= 2) {
+        fanInScalingTest(lProducers);
+    }
+
+    ///
+    /// Broadcast (fan-out) tests ->
+    ///
+
+    auto lBroadcast = new Broadcast();
+    broadcastTest("FastQueueBroadcast", lBroadcast, 1);
+    delete lBroadcast;
+    auto lFanOutQueues = new FanOutQueue[BROADCAST_CONSUMERS];
+    broadcastTest("FastQueue x" + std::to_string(BROADCAST_CONSUMERS), lFanOutQueues, BROADCAST_CONSUMERS);
+    delete[] lFanOutQueues;
+
+    ///
+    /// Work-stealing tests ->
+    ///
+
+    workStealingTest("FastQueueStealPool (no stealing)", false);
+    workStealingTest("FastQueueStealPool", true);
+
+    ///
+    /// Framed message tests ->
+    ///
+
+    gStartBench = false;
+    gActiveProducer = true;
+    gCounter = 0;
+    gActiveConsumer = 0;
+
+    // Create the queue
+    auto lFastQueueVector = new FastQueue<std::vector<uint8_t> *, QUEUE_MASK, L1_CACHE_LINE>();
+
+    // Start the consumer(s) / Producer(s)
+    gActiveConsumer++;
+    std::thread([lFastQueueVector] { return fastQueueConsumerVector(lFastQueueVector, CONSUMER_CPU); }).detach();
+    std::thread([lFastQueueVector] { return fastQueueProducerVector(lFastQueueVector, PRODUCER_CPU); }).detach();
 
     // Wait for the OS to actually get it done.
-    std::this_thread::sleep_for(std::chrono::milliseconds(100));
+    std::this_thread::sleep_for(std::chrono::milliseconds(10));
 
     // Start the test
-    std::cout << "DeaodSPSC pointer test started." << std::endl;
+    std::cout << "FastQueueVector " << BYTE_MESSAGE_MIN << "-" << BYTE_MESSAGE_MAX << "B test started." << std::endl;
     gStartBench = true;
     std::this_thread::sleep_for(std::chrono::seconds(TEST_TIME_DURATION_SEC));
 
     // End the test
     gActiveProducer = false;
-    std::cout << "DeaodSPSC pointer test ended." << std::endl;
+    std::cout << "FastQueueVector test ended." << std::endl;
 
     // Wait for the consumers to 'join'
     // Why not the classic join? I prepared for a multi thread case I need this function for.
@@ -590,40 +3463,76 @@ int main() {
     }
 
     // Garbage collect the queue
-    delete deaodSPSC;
+    delete lFastQueueVector;
 
     // Print the result.
-    std::cout << "DeaodSPSC Transactions -> " << gCounter / TEST_TIME_DURATION_SEC << "/s" << std::endl;
+    std::cout << "FastQueueVector Transactions -> " << gCounter / TEST_TIME_DURATION_SEC << "/s" << std::endl;
 
-    // Zero the test parameters.
     gStartBench = false;
     gActiveProducer = true;
     gCounter = 0;
     gActiveConsumer = 0;
 
+    // Create the queue
+    auto lFastByteQueue = new FastByteQueue<BYTE_QUEUE_BYTES, L1_CACHE_LINE>();
+
+    // Start the consumer(s) / Producer(s)
+    gActiveConsumer++;
+    std::thread([lFastByteQueue] { return fastByteQueueConsumer(lFastByteQueue, CONSUMER_CPU); }).detach();
+    std::thread([lFastByteQueue] { return fastByteQueueProducer(lFastByteQueue, PRODUCER_CPU); }).detach();
+
+    // Wait for the OS to actually get it done.
+    std::this_thread::sleep_for(std::chrono::milliseconds(10));
+
+    // Start the test
+    std::cout << "FastByteQueue " << BYTE_MESSAGE_MIN << "-" << BYTE_MESSAGE_MAX << "B test started." << std::endl;
+    gStartBench = true;
+    std::this_thread::sleep_for(std::chrono::seconds(TEST_TIME_DURATION_SEC));
+
+    // End the test
+    gActiveProducer = false;
+    std::cout << "FastByteQueue test ended." << std::endl;
+
+    // Wait for the consumers to 'join'
+    // Why not the classic join? I prepared for a multi thread case I need this function for.
+    while (gActiveConsumer) {
+        std::this_thread::sleep_for(std::chrono::milliseconds(1));
+    }
+
+    // Garbage collect the queue
+    delete lFastByteQueue;
+
+    // Print the result.
+    std::cout << "FastByteQueue Transactions -> " << gCounter / TEST_TIME_DURATION_SEC << "/s" << std::endl;
+
     ///
-    /// FastQueueRaw test ->
+    /// Buffer recycling tests ->
     ///
 
+    gStartBench = false;
+    gActiveProducer = true;
+    gCounter = 0;
+    gActiveConsumer = 0;
+
     // Create the queue
-    auto lFastQueueRaw = new FastQueue<MyObject *, QUEUE_MASK, L1_CACHE_LINE>();
+    auto lFastQueueBuffer = new FastQueue<MyBuffer *, QUEUE_MASK, L1_CACHE_LINE>();
 
     // Start the consumer(s) / Producer(s)
     gActiveConsumer++;
-    std::thread([lFastQueueRaw] { return fastQueueConsumerRaw(lFastQueueRaw, CONSUMER_CPU); }).detach();
-    std::thread([lFastQueueRaw] { return fastQueueProducerRaw(lFastQueueRaw, PRODUCER_CPU); }).detach();
+    std::thread([lFastQueueBuffer] { return fastQueueConsumerBuffer(lFastQueueBuffer, CONSUMER_CPU); }).detach();
+    std::thread([lFastQueueBuffer] { return fastQueueProducerBuffer(lFastQueueBuffer, PRODUCER_CPU); }).detach();
 
     // Wait for the OS to actually get it done.
     std::this_thread::sleep_for(std::chrono::milliseconds(10));
 
     // Start the test
-    std::cout << "FastQueueRaw pointer test started." << std::endl;
+    std::cout << "FastQueueNewDelete " << RECYCLE_BUFFER_SIZE << "B test started." << std::endl;
     gStartBench = true;
     std::this_thread::sleep_for(std::chrono::seconds(TEST_TIME_DURATION_SEC));
 
     // End the test
     gActiveProducer = false;
-    std::cout << "FastQueueRaw pointer test ended." << std::endl;
+    std::cout << "FastQueueNewDelete test ended." << std::endl;
 
     // Wait for the consumers to 'join'
     // Why not the classic join? I prepared for a multi thread case I need this function for.
@@ -632,10 +3541,59 @@ int main() {
     }
 
     // Garbage collect the queue
-    delete lFastQueueRaw;
+    delete lFastQueueBuffer;
 
     // Print the result.
-    std::cout << "FastQueueRaw Transactions -> " << gCounter / TEST_TIME_DURATION_SEC << "/s" << std::endl;
+    std::cout << "FastQueueNewDelete Transactions -> " << gCounter / TEST_TIME_DURATION_SEC << "/s" << std::endl;
+
+    gStartBench = false;
+    gActiveProducer = true;
+    gCounter = 0;
+    gActiveConsumer = 0;
+
+    // Create the queue
+    auto lFastQueueRecycler = new FastQueueRecycler<MyBuffer, QUEUE_MASK, L1_CACHE_LINE>();
+
+    // Start the consumer(s) / Producer(s)
+    gActiveConsumer++;
+    std::thread([lFastQueueRecycler] { return fastQueueConsumerRecycle(lFastQueueRecycler, CONSUMER_CPU); }).detach();
+    std::thread([lFastQueueRecycler] { return fastQueueProducerRecycle(lFastQueueRecycler, PRODUCER_CPU); }).detach();
+
+    // Wait for the OS to actually get it done.
+    std::this_thread::sleep_for(std::chrono::milliseconds(10));
+
+    // Start the test
+    std::cout << "FastQueueRecycler " << RECYCLE_BUFFER_SIZE << "B test started." << std::endl;
+    gStartBench = true;
+    std::this_thread::sleep_for(std::chrono::seconds(TEST_TIME_DURATION_SEC));
+
+    // End the test
+    gActiveProducer = false;
+    std::cout << "FastQueueRecycler test ended." << std::endl;
+
+    // Wait for the consumers to 'join'
+    // Why not the classic join? I prepared for a multi thread case I need this function for.
+    while (gActiveConsumer) {
+        std::this_thread::sleep_for(std::chrono::milliseconds(1));
+    }
+
+    // Garbage collect the queue
+    delete lFastQueueRecycler;
+
+    // Print the result.
+    std::cout << "FastQueueRecycler Transactions -> " << gCounter / TEST_TIME_DURATION_SEC << "/s" << std::endl;
+
+    // FastQueue caches the remote position on the local cache line. FastQueueUncached is the same queue
+    // reading the remote position every time, so the delta shows what the cached positions bring.
+    std::cout << std::endl;
+    printDelta("FastQueue vs. FastQueueUncached (cached positions)", lFastQueueResult, lFastQueueUncachedResult);
+    printDelta("FastQueue vs. FastQueueASM", lFastQueueResult, lFastQueueASMResult);
+    printDelta("FastQueueASMTry vs. FastQueueASM", lFastQueueASMTryResult, lFastQueueASMResult);
+    printDelta("FastQueueASMBulk vs. FastQueueASM", lFastQueueASMBulkResult, lFastQueueASMResult);
+#if __aarch64__ || _M_ARM64
+    printDelta("FastQueueASMAcqRel vs. FastQueueASM (dmb)", lFastQueueASMAcqRelResult, lFastQueueASMResult);
+#endif
+    printDelta("FastQueue vs. DeaodSPSC", lFastQueueResult, lDeaodSPSCResult);
 
 
     return EXIT_SUCCESS;
@@ -0,0 +1,224 @@
+//
+// Created by Anders Cedronius
+//
+
+// Usage
+
+// Multi producer single consumer (MPSC) queue built from one FastQueue (lane) per producer.
+// auto queue = FanInQueue<Type, Lanes, Size, L1-Cache size>
+// Lanes is the maximum number of producers (1 - 64)
+// Size and L1-Cache size are the FastQueue parameters of every lane
+// The optional layout, wait strategy and barrier policy are the FastQueue parameters of every lane. The wait
+// strategy is also what pop() uses when all lanes are empty.
+
+// Every producer thread registers once and pushes to its own lane
+// auto lane = queue.registerProducer();
+// queue.push(lane, object/pointer)
+// queue.pushBulk(lane, first, last)
+
+// The consumer drains the lanes round-robin
+// auto result = queue.pop(); (blocking, {} when stopped and drained)
+// auto count = queue.popBulk(out, maxCount); (non-blocking)
+
+// Call queue.stopQueue() from any thread to signal end of transaction
+// The consumer gets every item pushed before stopQueue(). Producers still pushing when the queue is stopped
+// should stop when they see isQueueStopped(), items they push after the consumer found the lanes empty are dropped.
+
+// A producer sets its lanes bit in a ready mask after pushing, if the bit is not already set. The consumer
+// only visits lanes with the bit set and clears the bit when it finds the lane empty, so idle lanes cost
+// the consumer nothing. Clearing the bit and re-checking the lane on the consumer side and publishing the
+// item and checking the bit on the producer side are both ordered by a full barrier. So either the consumer
+// sees the item or the producer sees the cleared bit and sets it again.
+// Setting a bit and stopping the queue also bump a ready sequence, that is the word a waiting pop() watches.
+// So the producers only notify the wait strategy when a lane goes from idle to ready.
+
+#pragma once
+
+#include "FastQueue.h"
+
+template<typename T, uint64_t LANES, uint64_t RING_BUFFER_SIZE, uint64_t L1_CACHE_LNE,
+        FastQueueLayout LAYOUT = FastQueueLayout::PADDED, typename WAIT_STRATEGY = FastQueueWaitBusy,
+        typename BARRIER = FastQueueBarrierFence>
+class FanInQueue {
+public:
+    using Lane = FastQueue<T, RING_BUFFER_SIZE, L1_CACHE_LNE, LAYOUT, WAIT_STRATEGY, BARRIER>;
+
+    explicit FanInQueue() = default;
+
+    //Register a producer. Returns the lane to push to. Maybe called from any thread.
+    uint64_t registerProducer() {
+        uint64_t lLane = mRegisteredLanes.fetch_add(1);
+        if (lLane >= LANES) {
+            mRegisteredLanes.fetch_sub(1);
+            throw std::runtime_error("All lanes of the FanInQueue are taken.");
+        }
+        return lLane;
+    }
+
+    ///////////////////////
+    /// Push part
+    ///////////////////////
+
+    void push(uint64_t aLane, T &rItem) noexcept {
+        mLanes[aLane].push(rItem);
+        markReady(aLane);
+    }
+
+    //Returns the number of items pushed
+    template<typename ITERATOR>
+    uint64_t pushBulk(uint64_t aLane, ITERATOR aFirst, ITERATOR aLast) noexcept {
+        uint64_t lCount = mLanes[aLane].pushBulk(aFirst, aLast);
+        if (lCount) {
+            markReady(aLane);
+        }
+        return lCount;
+    }
+
+    ///////////////////////
+    /// Pop part
+    ///////////////////////
+
+    //Pop up to aMaxCount items to aOut. Lanes with data are served round-robin, at most aQuantum items
+    //per lane before moving on to the next lane. Returns the number of items popped, 0 if all lanes are empty.
+    template<typename OUTPUT_ITERATOR>
+    uint64_t popBulk(OUTPUT_ITERATOR aOut, uint64_t aMaxCount, uint64_t aQuantum = 16) noexcept {
+        uint64_t lReady = mReadyLanes.load(std::memory_order_acquire);
+        uint64_t lCount = 0;
+        while (lReady && lCount < aMaxCount) {
+            //Next ready lane at or after mNextLane
+            uint64_t lLane = (mNextLane + countTrailingZeros(rotateRight(lReady, mNextLane))) % LANES;
+            uint64_t lBit = 1ULL << lLane;
+            uint64_t lWanted = aMaxCount - lCount < aQuantum ? aMaxCount - lCount : aQuantum;
+            uint64_t lPopped = mLanes[lLane].popBulk(aOut, lWanted);
+            for (uint64_t i = 0; i < lPopped; i++) {
+                ++aOut;
+            }
+            lCount += lPopped;
+            if (lPopped < lWanted) {
+                //The lane looks empty, clear the bit then look again to not miss a racing push
+                mReadyLanes.fetch_and(~lBit, std::memory_order_seq_cst);
+                //The RMW alone does not order the load of the lanes write position after it (arm64)
+                std::atomic_thread_fence(std::memory_order_seq_cst);
+                if (mLanes[lLane].tryPop() == Lane::FastQueueMessages::READY_TO_POP) {
+                    mReadyLanes.fetch_or(lBit, std::memory_order_relaxed);
+                }
+            }
+            mNextLane = (lLane + 1) % LANES;
+            lReady &= ~lBit;
+            if (!lReady) {
+                //One round done, start over with the lanes that are still ready
+                lReady = mReadyLanes.load(std::memory_order_acquire);
+            }
+        }
+        return lCount;
+    }
+
+    //Blocking pop. Returns {} when the queue is stopped and all lanes are drained.
+    T pop() noexcept {
+        T lItem;
+        uint64_t lSpins = 0;
+        while (true) {
+            //Read before looking in the lanes, a lane getting ready after that changes it
+            uint64_t lSequence = mReadySequence.load(std::memory_order_acquire);
+            if (popBulk(&lItem, 1)) {
+                return lItem;
+            }
+            if (mStopped.load(std::memory_order_acquire)) {
+                //Stopped, do not trust the ready mask and look in every lane
+                for (auto &rLane: mLanes) {
+                    if (rLane.popBulk(&lItem, 1)) {
+                        return lItem;
+                    }
+                }
+                return {};
+            }
+            mWaitStrategy.wait(readySequence(), lSequence, lSpins++);
+        }
+    }
+
+    //Stop all lanes (Maybe called from any thread)
+    void stopQueue() {
+        //Stopped before the lanes. A push on a full lane that gave up as the lane was stopped is followed by
+        //isQueueStopped() being true, so the producer does not go on to push the next item behind the gap.
+        mStopped.store(true, std::memory_order_seq_cst);
+        std::atomic_thread_fence(std::memory_order_seq_cst);
+        for (auto &rLane: mLanes) {
+            rLane.stopQueue();
+        }
+        mReadySequence.fetch_add(1, std::memory_order_seq_cst);
+        mWaitStrategy.notify(readySequence());
+    }
+
+    //Is the queue stopped?
+    bool isQueueStopped() {
+        //Orders the read of the lanes stop flag in an earlier push before this read (arm64)
+        std::atomic_thread_fence(std::memory_order_acquire);
+        return mStopped.load(std::memory_order_acquire);
+    }
+
+    //True when the queue is stopped and all lanes are empty (consumer side)
+    bool isDrained() {
+        if (!mStopped.load(std::memory_order_acquire)) {
+            return false;
+        }
+        for (auto &rLane: mLanes) {
+            if (rLane.tryPop() == Lane::FastQueueMessages::READY_TO_POP) {
+                return false;
+            }
+        }
+        return true;
+    }
+
+    ///Delete copy and move constructors and assign operators
+    FanInQueue(FanInQueue const &) = delete;              // Copy construct
+    FanInQueue(FanInQueue &&) = delete;                   // Move construct
+    FanInQueue &operator=(FanInQueue const &) = delete;   // Copy assign
+    FanInQueue &operator=(FanInQueue &&) = delete;        // Move assign
+private:
+    static_assert(LANES >= 1 && LANES <= 64, "A FanInQueue has 1 to 64 lanes");
+    static_assert(sizeof(std::atomic<uint64_t>) == sizeof(uint64_t) && std::atomic<uint64_t>::is_always_lock_free,
+                  "The wait strategies watch the ready sequence as a plain 64-bit word");
+
+    inline const volatile uint64_t &readySequence() {
+        return *reinterpret_cast<const volatile uint64_t *>(&mReadySequence);
+    }
+
+    inline void markReady(uint64_t aLane) {
+        uint64_t lBit = 1ULL << aLane;
+        //Order the published item before reading the ready mask
+        std::atomic_thread_fence(std::memory_order_seq_cst);
+        if (!(mReadyLanes.load(std::memory_order_relaxed) & lBit)) {
+            mReadyLanes.fetch_or(lBit, std::memory_order_seq_cst);
+            mReadySequence.fetch_add(1, std::memory_order_seq_cst);
+            mWaitStrategy.notify(readySequence());
+        }
+    }
+
+    static inline uint64_t rotateRight(uint64_t aMask, uint64_t aShift) {
+        //Rotate within the LANES lowest bits
+        if (!aShift) return aMask;
+        uint64_t lLaneMask = LANES == 64 ? ~0ULL : (1ULL << LANES) - 1;
+        return ((aMask >> aShift) | (aMask << (LANES - aShift))) & lLaneMask;
+    }
+
+    static inline uint64_t countTrailingZeros(uint64_t aMask) {
+#ifdef _MSC_VER
+        unsigned long lIndex;
+        _BitScanForward64(&lIndex, aMask);
+        return lIndex;
+#else
+        return __builtin_ctzll(aMask);
+#endif
+    }
+
+    //Consumer private
+    alignas(L1_CACHE_LNE) uint64_t mNextLane = 0;
+    //Written by producers when a lane goes from idle to ready, by the consumer when a lane is found empty
+    alignas(L1_CACHE_LNE) std::atomic<uint64_t> mReadyLanes = {0};
+    //Bumped when a bit is set in mReadyLanes and by stopQueue()
+    std::atomic<uint64_t> mReadySequence = {0};
+    alignas(L1_CACHE_LNE) std::atomic<uint64_t> mRegisteredLanes = {0};
+    alignas(L1_CACHE_LNE) std::atomic<bool> mStopped = {false};
+    alignas(L1_CACHE_LNE) WAIT_STRATEGY mWaitStrategy;
+    alignas(L1_CACHE_LNE) Lane mLanes[LANES];
+};
@@ -0,0 +1,108 @@
+//
+// Created by Anders Cedronius
+//
+
+// FanInQueue stop integrity test
+// Every round FAN_IN_LANES producers push lane stamped counters as fast as they can and a consumer pops them
+// with pop() while a third party stops the queue after a random delay, with the producers still pushing.
+// The consumer verifies the order per lane and must see the end of the queue. A consumer not returning
+// within ROUND_TIMEOUT_MS (a stranded item or a missed stop) fails the test. The lanes are set shallow
+// (3 entries) to make the producers face full lanes as often as possible.
+// The rounds run with the busy spin and with the futex wait strategy (the consumer sleeping in pop()).
+
+#include <random>
+#include <iostream>
+#include <thread>
+#include <vector>
+#include "FastQueueFanIn.h"
+
+#define QUEUE_MASK 0b11
+#define L1_CACHE_LINE 64
+#define FAN_IN_LANES 4
+#define TEST_ROUNDS 2000
+#define ROUND_TIMEOUT_MS 10000
+
+using FanInBusy = FanInQueue<uint64_t, FAN_IN_LANES, QUEUE_MASK, L1_CACHE_LINE>;
+//Short spin so the consumer goes to sleep often
+using FanInFutex = FanInQueue<uint64_t, FAN_IN_LANES, QUEUE_MASK, L1_CACHE_LINE, FastQueueLayout::PADDED,
+        FastQueueWaitFutex<10>>;
+
+std::atomic<bool> gFailed = false;
+
+//The lane in the upper 16 bits, the counter starts at 1 as 0 is the end of the queue
+template<typename FanIn>
+void producer(FanIn *pQueue) {
+    uint64_t lLane = pQueue->registerProducer();
+    uint64_t lCounter = 1;
+    while (!pQueue->isQueueStopped()) {
+        uint64_t lItem = (lLane << 48) | lCounter++;
+        pQueue->push(lLane, lItem);
+    }
+}
+
+template<typename FanIn>
+void consumer(FanIn *pQueue, std::atomic<bool> *pDone) {
+    std::vector<uint64_t> lExpected(FAN_IN_LANES, 1);
+    while (true) {
+        uint64_t lItem = pQueue->pop();
+        if (!lItem) {
+            break;
+        }
+        uint64_t lLane = lItem >> 48;
+        if (lLane >= FAN_IN_LANES || (lItem & 0xFFFFFFFFFFFF) != lExpected[lLane]++) {
+            std::cout << "Test failed.. Not linear data. Lane " << lLane << " item " << (lItem & 0xFFFFFFFFFFFF)
+                      << std::endl;
+            gFailed = true;
+            break;
+        }
+    }
+    *pDone = true;
+}
+
+template<typename FanIn>
+bool runRounds(const std::string &rName) {
+    std::random_device lRndDevice;
+    std::mt19937 lMersenneEngine{lRndDevice()};
+    std::uniform_int_distribution<int> lDist{0, 2000};
+    std::cout << "FanInQueue " << rName << " stop test (start)" << std::endl;
+    for (uint64_t lRound = 0; lRound < TEST_ROUNDS && !gFailed; lRound++) {
+        auto lQueue = new FanIn();
+        std::atomic<bool> lConsumerDone = false;
+        std::thread lConsumer([lQueue, &lConsumerDone] { return consumer(lQueue, &lConsumerDone); });
+        std::vector<std::thread> lProducers;
+        for (uint64_t i = 0; i < FAN_IN_LANES; i++) {
+            lProducers.emplace_back([lQueue] { return producer(lQueue); });
+        }
+        std::this_thread::sleep_for(std::chrono::microseconds(lDist(lMersenneEngine)));
+        lQueue->stopQueue();
+        for (auto &rProducer: lProducers) {
+            rProducer.join();
+        }
+        auto lDeadline = std::chrono::steady_clock::now() + std::chrono::milliseconds(ROUND_TIMEOUT_MS);
+        while (!lConsumerDone && std::chrono::steady_clock::now() < lDeadline) {
+            std::this_thread::sleep_for(std::chrono::milliseconds(1));
+        }
+        if (!lConsumerDone) {
+            std::cout << "Test failed.. The consumer did not see the end of the queue in round " << lRound
+                      << std::endl;
+            //The consumer is stuck in pop(), leave it and the queue behind
+            lConsumer.detach();
+            return false;
+        }
+        lConsumer.join();
+        delete lQueue;
+    }
+    if (gFailed) {
+        return false;
+    }
+    std::cout << "FanInQueue " << rName << " did " << TEST_ROUNDS << " rounds." << std::endl;
+    return true;
+}
+
+int main() {
+    if (!runRounds<FanInBusy>("busy") || !runRounds<FanInFutex>("futex")) {
+        return EXIT_FAILURE;
+    }
+    std::cout << "Test ended." << std::endl;
+    return EXIT_SUCCESS;
+}
@@ -0,0 +1,227 @@
+//
+// Created by Anders Cedronius
+//
+
+// Process to process speed-test.
+// FastQueueShared, a pipe and a Unix domain socket
+// 1. The producer process forks a consumer process
+// 2. The producer stamps a counter in every message and sends it to the consumer
+// 3. The consumer checks the counter for the expected value
+// 4. After TEST_TIME_DURATION_SEC the producer sends an end marker and waits for the consumer to drain
+// the transport. The throughput includes the drain time.
+
+#include <iostream>
+#include <thread>
+#include <string>
+#include <sys/socket.h>
+#include <sys/wait.h>
+#include "PinToCPU.h"
+#include "FastQueueShared.h"
+
+#define QUEUE_MASK 0b1111
+#define L1_CACHE_LINE 64
+#define TEST_TIME_DURATION_SEC 10
+//Run the consumer on CPU
+#define CONSUMER_CPU 0
+//Run the producer on CPU
+#define PRODUCER_CPU 2
+
+//Message sent between the processes. Index 0 marks the end of the test.
+struct MyMessage {
+    uint64_t mIndex;
+    uint8_t mPayload[56];
+};
+
+using SharedQueue = FastQueueShared<MyMessage, QUEUE_MASK, L1_CACHE_LINE>;
+
+bool writeAll(int aFd, const void *pData, size_t aSize) {
+    auto lpData = (const uint8_t *) pData;
+    while (aSize) {
+        ssize_t lWritten = write(aFd, lpData, aSize);
+        if (lWritten <= 0) {
+            if (lWritten < 0 && errno == EINTR) continue;
+            return false;
+        }
+        lpData += lWritten;
+        aSize -= lWritten;
+    }
+    return true;
+}
+
+bool readAll(int aFd, void *pData, size_t aSize) {
+    auto lpData = (uint8_t *) pData;
+    while (aSize) {
+        ssize_t lRead = read(aFd, lpData, aSize);
+        if (lRead <= 0) {
+            if (lRead < 0 && errno == EINTR) continue;
+            return false;
+        }
+        lpData += lRead;
+        aSize -= lRead;
+    }
+    return true;
+}
+
+//Runs in the child process. Returns the process exit code.
+int consumeFromFd(int aFd) {
+    if (!pinThread(CONSUMER_CPU)) {
+        std::cout << "Pin CPU fail. " << std::endl;
+    }
+    uint64_t lCounter = 1;
+    MyMessage lMessage = {};
+    while (readAll(aFd, &lMessage, sizeof(MyMessage))) {
+        if (!lMessage.mIndex) {
+            return EXIT_SUCCESS;
+        }
+        if (lMessage.mIndex != lCounter++) {
+            std::cout << "Queue item error" << std::endl;
+            return EXIT_FAILURE;
+        }
+    }
+    return EXIT_FAILURE;
+}
+
+//Runs in the parent process. Returns the number of messages sent.
+uint64_t produceToFd(int aFd) {
+    if (!pinThread(PRODUCER_CPU)) {
+        std::cout << "Pin CPU fail. " << std::endl;
+    }
+    uint64_t lCounter = 1;
+    MyMessage lMessage = {};
+    auto lEnd = std::chrono::steady_clock::now() + std::chrono::seconds(TEST_TIME_DURATION_SEC);
+    while (std::chrono::steady_clock::now() < lEnd) {
+        //Check the time every 1024 messages
+        for (int i = 0; i < 1024; i++) {
+            lMessage.mIndex = lCounter++;
+            if (!writeAll(aFd, &lMessage, sizeof(MyMessage))) {
+                return lCounter - 2;
+            }
+        }
+    }
+    lMessage.mIndex = 0;
+    writeAll(aFd, &lMessage, sizeof(MyMessage));
+    return lCounter - 1;
+}
+
+//Wait for the child and print the result
+void printResult(const std::string &rName, pid_t aChild, uint64_t aMessages,
+                 std::chrono::steady_clock::time_point aStart) {
+    int lStatus = 0;
+    waitpid(aChild, &lStatus, 0);
+    double lSeconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - aStart).count();
+    std::cout << rName << " test ended." << std::endl;
+    if (!WIFEXITED(lStatus) || WEXITSTATUS(lStatus) != EXIT_SUCCESS) {
+        std::cout << rName << " consumer failed." << std::endl;
+        return;
+    }
+    std::cout << rName << " Transactions -> " << (uint64_t) ((double) aMessages / lSeconds) << "/s" << std::endl;
+}
+
+/// -----------------------------------------------------------
+///
+/// FastQueueShared section
+///
+/// -----------------------------------------------------------
+
+void fastQueueSharedTest() {
+    std::string lName = "/fastqueue_ipc_bench_" + std::to_string(getpid());
+    SharedQueue lQueue(lName, FastQueueSharedMode::CREATE);
+
+    std::cout << "FastQueueShared test started." << std::endl;
+    pid_t lChild = fork();
+    if (lChild == 0) {
+        SharedQueue lAttached(lName, FastQueueSharedMode::ATTACH);
+        if (!pinThread(CONSUMER_CPU)) {
+            std::cout << "Pin CPU fail. " << std::endl;
+        }
+        uint64_t lCounter = 1;
+        while (true) {
+            MyMessage lMessage = lAttached->pop();
+            if (!lMessage.mIndex) {
+                break;
+            }
+            if (lMessage.mIndex != lCounter++) {
+                std::cout << "Queue item error" << std::endl;
+                _exit(EXIT_FAILURE);
+            }
+        }
+        _exit(EXIT_SUCCESS);
+    }
+
+    auto lStart = std::chrono::steady_clock::now();
+    if (!pinThread(PRODUCER_CPU)) {
+        std::cout << "Pin CPU fail. " << std::endl;
+    }
+    uint64_t lCounter = 1;
+    MyMessage lMessage = {};
+    auto lEnd = lStart + std::chrono::seconds(TEST_TIME_DURATION_SEC);
+    while (std::chrono::steady_clock::now() < lEnd) {
+        for (int i = 0; i < 1024; i++) {
+            lMessage.mIndex = lCounter++;
+            lQueue->push(lMessage);
+        }
+    }
+    lQueue->stopQueue();
+    printResult("FastQueueShared", lChild, lCounter - 1, lStart);
+}
+
+/// -----------------------------------------------------------
+///
+/// Pipe section
+///
+/// -----------------------------------------------------------
+
+void pipeTest() {
+    int lFds[2];
+    if (pipe(lFds)) {
+        std::cout << "Failed creating pipe." << std::endl;
+        return;
+    }
+    std::cout << "Pipe test started." << std::endl;
+    pid_t lChild = fork();
+    if (lChild == 0) {
+        close(lFds[1]);
+        _exit(consumeFromFd(lFds[0]));
+    }
+    close(lFds[0]);
+    auto lStart = std::chrono::steady_clock::now();
+    uint64_t lMessages = produceToFd(lFds[1]);
+    close(lFds[1]);
+    printResult("Pipe", lChild, lMessages, lStart);
+}
+
+/// -----------------------------------------------------------
+///
+/// Unix domain socket section
+///
+/// -----------------------------------------------------------
+
+void unixSocketTest() {
+    int lFds[2];
+    if (socketpair(AF_UNIX, SOCK_STREAM, 0, lFds)) {
+        std::cout << "Failed creating socket pair." << std::endl;
+        return;
+    }
+    std::cout << "UnixSocket test started." << std::endl;
+    pid_t lChild = fork();
+    if (lChild == 0) {
+        close(lFds[1]);
+        _exit(consumeFromFd(lFds[0]));
+    }
+    close(lFds[0]);
+    auto lStart = std::chrono::steady_clock::now();
+    uint64_t lMessages = produceToFd(lFds[1]);
+    close(lFds[1]);
+    printResult("UnixSocket", lChild, lMessages, lStart);
+}
+
+int main() {
+    //Flush before forking so the child does not print the parents buffered output
+    std::cout << std::flush;
+    fastQueueSharedTest();
+    std::cout << std::flush;
+    pipeTest();
+    std::cout << std::flush;
+    unixSocketTest();
+    return EXIT_SUCCESS;
+}
@@ -0,0 +1,144 @@
+//
+// Created by Anders Cedronius
+//
+
+// Usage
+
+// A FastQueue of pointers paired with a return ring so the buffers are recycled instead of being allocated by
+// the producer and freed by the consumer. All buffers are allocated by the constructor.
+// auto queue = FastQueueRecycler<Type, Size, L1-Cache size>
+// Type of the buffer (default constructed once for every buffer in the pool)
+// Size and L1-Cache size are the FastQueue parameters of the forward queue
+// Optional POOL_SIZE number of buffers (default two times the forward queue) and RETURN_BATCH the number of
+// buffers the consumer collects before returning them in one go (default 16)
+
+// Producer
+// Type *buffer = queue.acquire(); (nullptr if all buffers are in flight, try again later)
+// fill the buffer
+// queue.push(buffer)
+
+// Consumer
+// Type *buffer = queue.pop(); (blocking, nullptr when the queue is stopped and drained)
+// use the buffer
+// queue.recycle(buffer)
+
+// Call queue.stopQueue() from any thread to signal end of transaction
+
+// The buffers are never freed by another thread than the one allocating them, and the return ring is written
+// with one fence and one index update every RETURN_BATCH buffers. The consumer hands back the buffers it
+// holds when the forward queue runs empty so the producer can not starve while the consumer waits.
+
+#pragma once
+
+#include "FastQueue.h"
+
+template<typename T, uint64_t RING_BUFFER_SIZE, uint64_t L1_CACHE_LNE,
+        uint64_t POOL_SIZE = (RING_BUFFER_SIZE + 1) * 2, uint64_t RETURN_BATCH = 16>
+class FastQueueRecycler {
+public:
+    explicit FastQueueRecycler() : mBuffers(POOL_SIZE) {
+        //All buffers start on the return ring
+        std::vector<T *> lBuffers;
+        for (auto &rBuffer: mBuffers) {
+            lBuffers.push_back(&rBuffer.mObj);
+        }
+        mReturn.pushBulk(lBuffers.begin(), lBuffers.end());
+    }
+
+    ///////////////////////
+    /// Producer part
+    ///////////////////////
+
+    //Returns a free buffer or nullptr if all buffers are in flight
+    T *acquire() noexcept {
+        if (mFreeIndex == mFreeCount) {
+            mFreeCount = mReturn.popBulk(mFree, RETURN_BATCH);
+            mFreeIndex = 0;
+            if (!mFreeCount) {
+                return nullptr;
+            }
+        }
+        return mFree[mFreeIndex++];
+    }
+
+    void push(T *pBuffer) noexcept {
+        mForward.push(pBuffer);
+    }
+
+    ///////////////////////
+    /// Consumer part
+    ///////////////////////
+
+    T *pop() noexcept {
+        if (mForward.tryPop() != Forward::FastQueueMessages::READY_TO_POP) {
+            //Going to wait, hand back what we hold
+            flush();
+        }
+        return mForward.pop();
+    }
+
+    //Give the buffer back to the producer
+    void recycle(T *pBuffer) noexcept {
+        mPending[mPendingCount++] = pBuffer;
+        if (mPendingCount == RETURN_BATCH) {
+            flush();
+        }
+    }
+
+    //Return the buffers collected by recycle() now
+    void flush() noexcept {
+        if (mPendingCount) {
+            //The return ring holds every buffer in the pool so this never comes up short
+            mReturn.pushBulk(mPending, mPending + mPendingCount);
+            mPendingCount = 0;
+        }
+    }
+
+    //Stop queue (Maybe called from any thread)
+    void stopQueue() {
+        mForward.stopQueue();
+    }
+
+    //Is the queue stopped?
+    bool isQueueStopped() {
+        return mForward.isQueueStopped();
+    }
+
+    ///Delete copy and move constructors and assign operators
+    FastQueueRecycler(FastQueueRecycler const &) = delete;              // Copy construct
+    FastQueueRecycler(FastQueueRecycler &&) = delete;                   // Move construct
+    FastQueueRecycler &operator=(FastQueueRecycler const &) = delete;   // Copy assign
+    FastQueueRecycler &operator=(FastQueueRecycler &&) = delete;        // Move assign
+private:
+    static_assert(POOL_SIZE >= 1, "The pool must hold at least one buffer");
+    static_assert(RETURN_BATCH >= 1, "RETURN_BATCH must be at least 1");
+
+    //Smallest contiguous bitmask from LSB holding aCount items (the ring holds mask items)
+    static constexpr uint64_t returnMask(uint64_t aCount) {
+        uint64_t lMask = 1;
+        while (lMask < aCount) {
+            lMask = (lMask << 1) | 1;
+        }
+        return lMask;
+    }
+
+    using Forward = FastQueue<T *, RING_BUFFER_SIZE, L1_CACHE_LNE>;
+    using Return = FastQueue<T *, returnMask(POOL_SIZE), L1_CACHE_LNE, FastQueueLayout::DENSE>;
+
+    //Every buffer starts on its own cache line and no other buffer shares its last one, so the producer filling
+    //one buffer and the consumer reading another never touch the same line
+    struct alignas(L1_CACHE_LNE) mBuffer {
+        T mObj;
+    };
+
+    std::vector<mBuffer> mBuffers;
+    //Producer private
+    alignas(L1_CACHE_LNE) T *mFree[RETURN_BATCH];
+    uint64_t mFreeIndex = 0;
+    uint64_t mFreeCount = 0;
+    //Consumer private
+    alignas(L1_CACHE_LNE) T *mPending[RETURN_BATCH];
+    uint64_t mPendingCount = 0;
+    alignas(L1_CACHE_LNE) Forward mForward;
+    alignas(L1_CACHE_LNE) Return mReturn;
+};
@@ -0,0 +1,183 @@
+//
+// Created by Anders Cedronius
+//
+
+// Usage
+
+// FastQueue placed in shared memory so the producer and consumer can live in different processes.
+// The payload must be trivially copyable (for example a struct of values or an offset into a shared arena),
+// pointers to the heap of one process mean nothing in the other process.
+
+// The creating process
+// auto sharedQueue = FastQueueShared<Type, Size, L1-Cache size>("/my_queue", FastQueueSharedMode::CREATE);
+// The attaching process
+// auto sharedQueue = FastQueueShared<Type, Size, L1-Cache size>("/my_queue", FastQueueSharedMode::ATTACH);
+// Then use the queue as any FastQueue
+// sharedQueue->push(item) / sharedQueue->pop() ...
+
+// The creator removes the name when the FastQueueShared object is destroyed. Already attached processes keep
+// their mapping.
+
+// A file descriptor can be used instead of a name. For example a memfd_create() descriptor inherited over fork()
+// or passed over a Unix domain socket. The caller owns the descriptor.
+// auto sharedQueue = FastQueueShared<Type, Size, L1-Cache size>(fd, FastQueueSharedMode::CREATE);
+
+#pragma once
+
+#include "FastQueue.h"
+#include <string>
+#include <cstring>
+#include <cerrno>
+
+#if defined(__linux__) || defined(__APPLE__)
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <fcntl.h>
+#include <unistd.h>
+#else
+#error OS not supported
+#endif
+
+#define FASTQUEUE_SHARED_MAGIC 0x4661737451756575ULL //'FastQueu'
+#define FASTQUEUE_SHARED_VERSION 1
+#define FASTQUEUE_SHARED_ATTACH_TIMEOUT_MS 1000
+
+enum class FastQueueSharedMode : uint64_t {
+    CREATE,
+    ATTACH
+};
+
+template<typename T, uint64_t RING_BUFFER_SIZE, uint64_t L1_CACHE_LNE, FastQueueLayout LAYOUT = FastQueueLayout::PADDED,
+        typename WAIT_STRATEGY = FastQueueWaitBusy, typename BARRIER = FastQueueBarrierFence>
+class FastQueueShared {
+public:
+    using Queue = FastQueue<T, RING_BUFFER_SIZE, L1_CACHE_LNE, LAYOUT, WAIT_STRATEGY, BARRIER>;
+
+    FastQueueShared(const std::string &rName, FastQueueSharedMode aMode) : mName(rName), mMode(aMode) {
+        int lFlags = aMode == FastQueueSharedMode::CREATE ? O_CREAT | O_EXCL | O_RDWR : O_RDWR;
+        int lFd = shm_open(rName.c_str(), lFlags, 0600);
+        if (lFd < 0) {
+            throw std::runtime_error("Failed opening shared memory " + rName + ": " + std::strerror(errno));
+        }
+        try {
+            mapQueue(lFd, aMode);
+        } catch (...) {
+            close(lFd);
+            if (aMode == FastQueueSharedMode::CREATE) {
+                shm_unlink(rName.c_str());
+            }
+            throw;
+        }
+        close(lFd);
+    }
+
+    FastQueueShared(int aFd, FastQueueSharedMode aMode) : mMode(aMode) {
+        mapQueue(aFd, aMode);
+    }
+
+    ~FastQueueShared() {
+        if (mpMapping) {
+            munmap(mpMapping, mappingSize());
+        }
+        if (mMode == FastQueueSharedMode::CREATE && !mName.empty()) {
+            shm_unlink(mName.c_str());
+        }
+    }
+
+    Queue *operator->() {
+        return mpQueue;
+    }
+
+    Queue &queue() {
+        return *mpQueue;
+    }
+
+    ///Delete copy and move constructors and assign operators
+    FastQueueShared(FastQueueShared const &) = delete;              // Copy construct
+    FastQueueShared(FastQueueShared &&) = delete;                   // Move construct
+    FastQueueShared &operator=(FastQueueShared const &) = delete;   // Copy assign
+    FastQueueShared &operator=(FastQueueShared &&) = delete;        // Move assign
+private:
+    static_assert(RING_BUFFER_SIZE != 0, "A shared FastQueue must be sized at compile time");
+    static_assert(std::is_trivially_copyable<T>::value, "Only trivially copyable types can be shared between processes");
+    static_assert(std::atomic<uint64_t>::is_always_lock_free, "The shared control block needs lock free atomics");
+
+    //Placed first in the mapping, describes the queue that follows
+    struct alignas(L1_CACHE_LNE) ControlBlock {
+        uint64_t mMagic;
+        uint64_t mVersion;
+        uint64_t mQueueSize;
+        uint64_t mQueueOffset;
+        std::atomic<uint64_t> mReady;
+    };
+
+    static constexpr uint64_t queueOffset() {
+        return (sizeof(ControlBlock) + alignof(Queue) - 1) & ~(alignof(Queue) - 1);
+    }
+
+    static constexpr uint64_t mappingSize() {
+        return queueOffset() + sizeof(Queue);
+    }
+
+    void mapQueue(int aFd, FastQueueSharedMode aMode) {
+        if (aMode == FastQueueSharedMode::CREATE) {
+            if (ftruncate(aFd, (off_t) mappingSize())) {
+                throw std::runtime_error(std::string("Failed sizing shared memory: ") + std::strerror(errno));
+            }
+        } else {
+            //The creator may not have sized the memory yet
+            uint64_t lWaited = 0;
+            struct stat lStat = {};
+            while (true) {
+                if (fstat(aFd, &lStat)) {
+                    throw std::runtime_error(std::string("Failed reading shared memory size: ") + std::strerror(errno));
+                }
+                if ((uint64_t) lStat.st_size >= mappingSize()) {
+                    break;
+                }
+                if (lWaited++ >= FASTQUEUE_SHARED_ATTACH_TIMEOUT_MS) {
+                    throw std::runtime_error("Shared memory is too small for the queue.");
+                }
+                std::this_thread::sleep_for(std::chrono::milliseconds(1));
+            }
+        }
+        void *lpMapping = mmap(nullptr, mappingSize(), PROT_READ | PROT_WRITE, MAP_SHARED, aFd, 0);
+        if (lpMapping == MAP_FAILED) {
+            throw std::runtime_error(std::string("Failed mapping shared memory: ") + std::strerror(errno));
+        }
+        mpMapping = lpMapping;
+        auto lpControl = (ControlBlock *) lpMapping;
+        if (aMode == FastQueueSharedMode::CREATE) {
+            lpControl->mMagic = FASTQUEUE_SHARED_MAGIC;
+            lpControl->mVersion = FASTQUEUE_SHARED_VERSION;
+            lpControl->mQueueSize = sizeof(Queue);
+            lpControl->mQueueOffset = queueOffset();
+            mpQueue = new((uint8_t *) lpMapping + queueOffset()) Queue();
+            //Attaching processes may use the queue when they see mReady set
+            lpControl->mReady.store(1, std::memory_order_release);
+            return;
+        }
+        //Wait for the creator to finish constructing the queue
+        uint64_t lWaited = 0;
+        while (!lpControl->mReady.load(std::memory_order_acquire)) {
+            if (lWaited++ >= FASTQUEUE_SHARED_ATTACH_TIMEOUT_MS) {
+                munmap(lpMapping, mappingSize());
+                mpMapping = nullptr;
+                throw std::runtime_error("Timeout waiting for the shared queue to be created.");
+            }
+            std::this_thread::sleep_for(std::chrono::milliseconds(1));
+        }
+        if (lpControl->mMagic != FASTQUEUE_SHARED_MAGIC || lpControl->mVersion != FASTQUEUE_SHARED_VERSION ||
+            lpControl->mQueueSize != sizeof(Queue) || lpControl->mQueueOffset != queueOffset()) {
+            munmap(lpMapping, mappingSize());
+            mpMapping = nullptr;
+            throw std::runtime_error("The shared queue was created with different parameters.");
+        }
+        mpQueue = (Queue *) ((uint8_t *) lpMapping + queueOffset());
+    }
+
+    std::string mName;
+    FastQueueSharedMode mMode;
+    void *mpMapping = nullptr;
+    Queue *mpQueue = nullptr;
+};
@@ -0,0 +1,75 @@
+//
+// Created by Anders Cedronius
+//
+
+// FastQueueStealPool integrity test
+// One scheduler thread pushes TEST_ITEMS numbered items, most of them to worker 0, while STEAL_WORKERS workers
+// pop from their own ring and steal from the others. Every item must be taken exactly once, by the owner or by
+// a thief. The batches are small so the owner and the thieves race for the same items as often as possible.
+
+#include <iostream>
+#include <thread>
+#include <vector>
+#include "FastQueueStealing.h"
+
+#define QUEUE_MASK 0xFF
+#define L1_CACHE_LINE 64
+#define STEAL_WORKERS 4
+#define TEST_ITEMS 2000000
+#define BATCH_SIZE 2
+
+using StealPool = FastQueueStealPool<uint64_t, STEAL_WORKERS, QUEUE_MASK, L1_CACHE_LINE>;
+
+std::vector<std::atomic<uint8_t>> gSeen(TEST_ITEMS);
+std::atomic<uint64_t> gTaken = 0;
+std::atomic<uint64_t> gStolen = 0;
+
+void worker(StealPool *pPool, uint64_t aWorker) {
+    uint64_t lItems[BATCH_SIZE];
+    while (true) {
+        uint64_t lCount = pPool->popBatch(aWorker, lItems, BATCH_SIZE);
+        if (!lCount) {
+            lCount = pPool->steal(aWorker, lItems, BATCH_SIZE);
+            gStolen += lCount;
+        }
+        if (!lCount) {
+            if (pPool->isDrained()) {
+                break;
+            }
+            continue;
+        }
+        for (uint64_t i = 0; i < lCount; i++) {
+            gSeen[lItems[i]]++;
+        }
+        gTaken += lCount;
+    }
+}
+
+int main() {
+    auto lPool = new StealPool();
+    std::cout << "FastQueueStealPool test (start)" << std::endl;
+    std::vector<std::thread> lWorkers;
+    for (uint64_t i = 0; i < STEAL_WORKERS; i++) {
+        lWorkers.emplace_back([lPool, i] { return worker(lPool, i); });
+    }
+    //Every 8th item to another worker, the rest to worker 0 for the others to steal
+    for (uint64_t lItem = 0; lItem < TEST_ITEMS; lItem++) {
+        while (!lPool->tryPush(lItem & 7 ? 0 : (lItem >> 3) % STEAL_WORKERS, lItem)) {
+            std::this_thread::yield();
+        }
+    }
+    lPool->stopQueue();
+    for (auto &rWorker: lWorkers) {
+        rWorker.join();
+    }
+    delete lPool;
+
+    for (uint64_t lItem = 0; lItem < TEST_ITEMS; lItem++) {
+        if (gSeen[lItem] != 1) {
+            std::cout << "Test failed.. Item " << lItem << " taken " << (int) gSeen[lItem] << " times." << std::endl;
+            return EXIT_FAILURE;
+        }
+    }
+    std::cout << "Test ended. " << gTaken << " items taken, " << gStolen << " stolen." << std::endl;
+    return EXIT_SUCCESS;
+}
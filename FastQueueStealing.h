@@ -0,0 +1,239 @@
+//
+// Created by Anders Cedronius
+//
+
+// Usage
+
+// Work-stealing pool. One scheduler thread pushes tasks to per-worker rings, every worker pops from its own ring
+// and when that is empty steals a batch from the worker with the largest backlog.
+// auto pool = FastQueueStealPool<Type, Workers, Size, L1-Cache size>
+// Type must be trivially copyable (a task struct or a pointer)
+// Size of every workers ring as a contiguous bitmask from LSB example 0b1111
+
+// Scheduler thread
+// pool.push(worker, task) (blocking if the workers ring is full)
+// pool.tryPush(worker, task) (returns false if the workers ring is full)
+
+// Worker thread number 0 - (Workers - 1)
+// auto count = pool.pop(worker, out, maxCount); (own ring first then steal, non-blocking)
+// or pool.popBatch(worker, out, maxCount) (own ring only) and pool.steal(worker, out, maxCount)
+
+// Call pool.stopQueue() from any thread to signal end of transaction, pool.isDrained() is true
+// when the pool is stopped and all rings are empty.
+
+// The ring is a FastQueue with a shared consumer end. The push side is the same as FastQueue, one producer with
+// a cached copy of the read position. The owner and the thieves all take items from the oldest end (the consumer
+// end, the newest end belongs to the scheduler thread). A thief takes half of the backlog, the owner everything
+// up to maxCount.
+// The owner keeps the SPSC fast path. It writes a claim on its own cache line, and after a full barrier it checks
+// that no thief is at work on the ring. Then it copies the items and stores the read position like FastQueue,
+// with no atomic read-modify-write. A thief registers, and after a full barrier it backs off if it sees an owner
+// claim that is not yet published. Otherwise it copies the items and claims them with one compare-and-swap of the
+// read position. So either the owner sees the thief or the thief sees the claim. When the owner sees a thief it
+// drops the claim and takes the items with a compare-and-swap as well.
+
+#pragma once
+
+#include "FastQueue.h"
+
+template<typename T, uint64_t RING_BUFFER_SIZE, uint64_t L1_CACHE_LNE>
+class FastQueueStealRing {
+public:
+    explicit FastQueueStealRing() {
+        fastQueueVerifyBufferMask(RING_BUFFER_SIZE);
+    }
+
+    //Producer (one thread)
+    bool tryPush(const T &rItem) noexcept {
+        if (mWritePositionPush - mReadPositionCache >= RING_BUFFER_SIZE) {
+            mReadPositionCache = mReadPosition.load(std::memory_order_acquire);
+            if (mWritePositionPush - mReadPositionCache >= RING_BUFFER_SIZE) {
+                return false;
+            }
+        }
+        mRingBuffer[mWritePositionPush & RING_BUFFER_SIZE].mObj = rItem;
+        mWritePosition.store(++mWritePositionPush, std::memory_order_release);
+        return true;
+    }
+
+    //Owner, take up to aMaxCount items
+    uint64_t popBatch(T *pOut, uint64_t aMaxCount) noexcept {
+        //Only the owner stores the read position without a CAS, so a stale value here is caught below
+        uint64_t lRead = mReadPosition.load(std::memory_order_relaxed);
+        uint64_t lAvailable = mWritePosition.load(std::memory_order_acquire) - lRead;
+        uint64_t lCount = lAvailable < aMaxCount ? lAvailable : aMaxCount;
+        if (!lCount) {
+            return 0;
+        }
+        mOwnerClaim.store(lRead + lCount, std::memory_order_relaxed);
+        std::atomic_thread_fence(std::memory_order_seq_cst);
+        if (!mThieves.load(std::memory_order_acquire) && mReadPosition.load(std::memory_order_relaxed) == lRead) {
+            for (uint64_t i = 0; i < lCount; i++) {
+                pOut[i] = mRingBuffer[(lRead + i) & RING_BUFFER_SIZE].mObj;
+            }
+            mReadPosition.store(lRead + lCount, std::memory_order_release);
+            return lCount;
+        }
+        //A thief is at work, drop the claim and race it
+        mOwnerClaim.store(0, std::memory_order_relaxed);
+        return claim(pOut, aMaxCount, false, mReadPosition.load(std::memory_order_acquire));
+    }
+
+    //Thief, take half of the backlog (at least one item) but no more than aMaxCount items. Returns 0 if the
+    //ring is empty or the owner is taking items right now.
+    uint64_t steal(T *pOut, uint64_t aMaxCount) noexcept {
+        mThieves.fetch_add(1, std::memory_order_relaxed);
+        std::atomic_thread_fence(std::memory_order_seq_cst);
+        uint64_t lCount = 0;
+        uint64_t lRead = mReadPosition.load(std::memory_order_acquire);
+        //The owner claim is at or behind the read position once the owner has published its batch
+        if (mOwnerClaim.load(std::memory_order_relaxed) <= lRead) {
+            lCount = claim(pOut, aMaxCount, true, lRead);
+        }
+        mThieves.fetch_sub(1, std::memory_order_release);
+        return lCount;
+    }
+
+    //Items in the ring. Maybe called from any thread, the value is a snapshot.
+    uint64_t backlog() const noexcept {
+        uint64_t lRead = mReadPosition.load(std::memory_order_relaxed);
+        uint64_t lWrite = mWritePosition.load(std::memory_order_relaxed);
+        return lWrite > lRead ? lWrite - lRead : 0;
+    }
+
+    ///Delete copy and move constructors and assign operators
+    FastQueueStealRing(FastQueueStealRing const &) = delete;              // Copy construct
+    FastQueueStealRing(FastQueueStealRing &&) = delete;                   // Move construct
+    FastQueueStealRing &operator=(FastQueueStealRing const &) = delete;   // Copy assign
+    FastQueueStealRing &operator=(FastQueueStealRing &&) = delete;        // Move assign
+private:
+    static_assert(std::is_trivially_copyable<T>::value, "Stolen items are copied before they are claimed");
+
+    //The thieves path, and the owners when a thief is at work. aRead is the read position last seen.
+    uint64_t claim(T *pOut, uint64_t aMaxCount, bool aHalf, uint64_t aRead) noexcept {
+        uint64_t lRead = aRead;
+        while (true) {
+            uint64_t lAvailable = mWritePosition.load(std::memory_order_acquire) - lRead;
+            if (!lAvailable) {
+                return 0;
+            }
+            uint64_t lCount = aHalf ? (lAvailable + 1) / 2 : lAvailable;
+            lCount = lCount < aMaxCount ? lCount : aMaxCount;
+            //The slots can not be reused by the producer before the read position moves past them. If
+            //someone else claims them first the copies are thrown away and we try again.
+            for (uint64_t i = 0; i < lCount; i++) {
+                pOut[i] = mRingBuffer[(lRead + i) & RING_BUFFER_SIZE].mObj;
+            }
+            if (mReadPosition.compare_exchange_weak(lRead, lRead + lCount, std::memory_order_acq_rel,
+                                                    std::memory_order_acquire)) {
+                return lCount;
+            }
+        }
+    }
+
+    alignas(L1_CACHE_LNE) uint64_t mWritePositionPush = 0;
+    uint64_t mReadPositionCache = 0; //Producer local copy of mReadPosition
+    alignas(L1_CACHE_LNE) std::atomic<uint64_t> mWritePosition = {0};
+    //Written by the owner every batch, by a thief only when it steals
+    alignas(L1_CACHE_LNE) std::atomic<uint64_t> mReadPosition = {0};
+    //End of the batch the owner is taking, 0 when the owner races the thieves with a CAS
+    std::atomic<uint64_t> mOwnerClaim = {0};
+    //Thieves at work on this ring, only written when stealing
+    alignas(L1_CACHE_LNE) std::atomic<uint64_t> mThieves = {0};
+    alignas(L1_CACHE_LNE) FastQueueSlot<T, L1_CACHE_LNE> mRingBuffer[RING_BUFFER_SIZE + 1];
+};
+
+template<typename T, uint64_t WORKERS, uint64_t RING_BUFFER_SIZE, uint64_t L1_CACHE_LNE>
+class FastQueueStealPool {
+public:
+    using Ring = FastQueueStealRing<T, RING_BUFFER_SIZE, L1_CACHE_LNE>;
+
+    explicit FastQueueStealPool() = default;
+
+    ///////////////////////
+    /// Scheduler part
+    ///////////////////////
+
+    bool tryPush(uint64_t aWorker, const T &rItem) noexcept {
+        return mRings[aWorker].tryPush(rItem);
+    }
+
+    void push(uint64_t aWorker, const T &rItem) noexcept {
+        while (!mRings[aWorker].tryPush(rItem)) {
+            if (mStopped.load(std::memory_order_relaxed)) {
+                return;
+            }
+            fastQueueCpuRelax();
+        }
+    }
+
+    ///////////////////////
+    /// Worker part
+    ///////////////////////
+
+    //Own ring first, steal if it is empty
+    uint64_t pop(uint64_t aWorker, T *pOut, uint64_t aMaxCount) noexcept {
+        uint64_t lCount = mRings[aWorker].popBatch(pOut, aMaxCount);
+        if (lCount) {
+            return lCount;
+        }
+        return steal(aWorker, pOut, aMaxCount);
+    }
+
+    //Own ring only
+    uint64_t popBatch(uint64_t aWorker, T *pOut, uint64_t aMaxCount) noexcept {
+        return mRings[aWorker].popBatch(pOut, aMaxCount);
+    }
+
+    //Steal from the worker with the largest backlog
+    uint64_t steal(uint64_t aWorker, T *pOut, uint64_t aMaxCount) noexcept {
+        uint64_t lVictim = aWorker;
+        uint64_t lLargest = 0;
+        for (uint64_t i = 1; i < WORKERS; i++) {
+            uint64_t lWorker = (aWorker + i) % WORKERS;
+            uint64_t lBacklog = mRings[lWorker].backlog();
+            if (lBacklog > lLargest) {
+                lLargest = lBacklog;
+                lVictim = lWorker;
+            }
+        }
+        if (!lLargest) {
+            return 0;
+        }
+        return mRings[lVictim].steal(pOut, aMaxCount);
+    }
+
+    //Stop the pool (Maybe called from any thread)
+    void stopQueue() {
+        mStopped.store(true, std::memory_order_release);
+    }
+
+    //Is the pool stopped?
+    bool isQueueStopped() {
+        return mStopped.load(std::memory_order_acquire);
+    }
+
+    //True when the pool is stopped and all rings are empty
+    bool isDrained() {
+        if (!mStopped.load(std::memory_order_acquire)) {
+            return false;
+        }
+        for (auto &rRing: mRings) {
+            if (rRing.backlog()) {
+                return false;
+            }
+        }
+        return true;
+    }
+
+    ///Delete copy and move constructors and assign operators
+    FastQueueStealPool(FastQueueStealPool const &) = delete;              // Copy construct
+    FastQueueStealPool(FastQueueStealPool &&) = delete;                   // Move construct
+    FastQueueStealPool &operator=(FastQueueStealPool const &) = delete;   // Copy assign
+    FastQueueStealPool &operator=(FastQueueStealPool &&) = delete;        // Move assign
+private:
+    static_assert(WORKERS >= 1, "A FastQueueStealPool needs at least one worker");
+
+    alignas(L1_CACHE_LNE) std::atomic<bool> mStopped = {false};
+    alignas(L1_CACHE_LNE) Ring mRings[WORKERS];
+};
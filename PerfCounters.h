@@ -0,0 +1,193 @@
+//
+// Created by Anders Cedronius
+//
+
+// Usage
+
+// Hardware performance counters for one thread (Linux perf_event_open)
+// PerfCounters counters;
+// counters.open(); (counts the calling thread, so call it from the thread to measure)
+// counters.start();
+// the work
+// counters.stop();
+// if (counters.available(PerfCounters::CYCLES)) counters.value(PerfCounters::CYCLES)
+
+// A counter the kernel or the CPU does not provide is not available, the others still count.
+// Nothing is available on other systems than Linux or if perf_event_paranoid does not allow user space counting.
+// Only user space is counted and the values are scaled if the kernel had to multiplex the counters.
+
+#pragma once
+
+#include <cstdint>
+#include <cstring>
+#ifdef __linux
+#include <linux/perf_event.h>
+#include <sys/ioctl.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+#if defined(__x86_64__)
+#include <cpuid.h>
+#endif
+#endif
+
+class PerfCounters {
+public:
+    enum Counter {
+        CYCLES,
+        INSTRUCTIONS,
+        L1D_MISSES,
+        LLC_MISSES,
+        HITM,
+        COUNTERS
+    };
+
+    //Raw event counting loads that hit a modified line in another cores cache, 0 if not known for this CPU
+    static uint64_t defaultHitmEvent() {
+#if defined(__linux) && defined(__x86_64__)
+        unsigned int lEax, lEbx, lEcx, lEdx;
+        if (__get_cpuid(0, &lEax, &lEbx, &lEcx, &lEdx) &&
+            !std::memcmp(&lEbx, "Genu", 4) && !std::memcmp(&lEdx, "ineI", 4) && !std::memcmp(&lEcx, "ntel", 4)) {
+            //MEM_LOAD_L3_HIT_RETIRED.XSNP_HITM (XSNP_FWD from Ice Lake), event 0xd2 umask 0x04
+            return 0x04d2;
+        }
+#endif
+        return 0;
+    }
+
+    static const char *name(Counter aCounter) {
+        switch (aCounter) {
+            case CYCLES:
+                return "cycles";
+            case INSTRUCTIONS:
+                return "instructions";
+            case L1D_MISSES:
+                return "l1d_misses";
+            case LLC_MISSES:
+                return "llc_misses";
+            case HITM:
+                return "hitm";
+            default:
+                return "unknown";
+        }
+    }
+
+    //aHitmEvent raw perf event config used for HITM, 0 leaves HITM not available
+    explicit PerfCounters(uint64_t aHitmEvent = defaultHitmEvent()) : mHitmEvent(aHitmEvent) {
+        for (auto &rFd: mFd) {
+            rFd = -1;
+        }
+    }
+
+    ~PerfCounters() {
+        close();
+    }
+
+    //Open the counters for the calling thread. Returns false if no counter is available.
+    bool open() {
+        bool lAny = false;
+#ifdef __linux
+        for (int i = 0; i < COUNTERS; i++) {
+            perf_event_attr lAttr;
+            std::memset(&lAttr, 0, sizeof(lAttr));
+            lAttr.size = sizeof(lAttr);
+            lAttr.disabled = 1;
+            lAttr.exclude_kernel = 1;
+            lAttr.exclude_hv = 1;
+            lAttr.read_format = PERF_FORMAT_TOTAL_TIME_ENABLED | PERF_FORMAT_TOTAL_TIME_RUNNING;
+            switch (i) {
+                case CYCLES:
+                    lAttr.type = PERF_TYPE_HARDWARE;
+                    lAttr.config = PERF_COUNT_HW_CPU_CYCLES;
+                    break;
+                case INSTRUCTIONS:
+                    lAttr.type = PERF_TYPE_HARDWARE;
+                    lAttr.config = PERF_COUNT_HW_INSTRUCTIONS;
+                    break;
+                case L1D_MISSES:
+                    lAttr.type = PERF_TYPE_HW_CACHE;
+                    lAttr.config = PERF_COUNT_HW_CACHE_L1D | (PERF_COUNT_HW_CACHE_OP_READ << 8) |
+                                   (PERF_COUNT_HW_CACHE_RESULT_MISS << 16);
+                    break;
+                case LLC_MISSES:
+                    //The generic cache miss event is the last level cache on most CPUs
+                    lAttr.type = PERF_TYPE_HARDWARE;
+                    lAttr.config = PERF_COUNT_HW_CACHE_MISSES;
+                    break;
+                default:
+                    if (!mHitmEvent) {
+                        continue;
+                    }
+                    lAttr.type = PERF_TYPE_RAW;
+                    lAttr.config = mHitmEvent;
+                    break;
+            }
+            mFd[i] = (int) syscall(__NR_perf_event_open, &lAttr, 0, -1, -1, 0);
+            lAny |= mFd[i] >= 0;
+        }
+#endif
+        return lAny;
+    }
+
+    void start() {
+#ifdef __linux
+        for (auto lFd: mFd) {
+            if (lFd >= 0) {
+                ioctl(lFd, PERF_EVENT_IOC_RESET, 0);
+                ioctl(lFd, PERF_EVENT_IOC_ENABLE, 0);
+            }
+        }
+#endif
+    }
+
+    void stop() {
+#ifdef __linux
+        for (auto lFd: mFd) {
+            if (lFd >= 0) {
+                ioctl(lFd, PERF_EVENT_IOC_DISABLE, 0);
+            }
+        }
+        for (int i = 0; i < COUNTERS; i++) {
+            if (mFd[i] < 0) {
+                continue;
+            }
+            //value, time enabled, time running
+            uint64_t lRead[3] = {};
+            if (read(mFd[i], lRead, sizeof(lRead)) != sizeof(lRead)) {
+                mValue[i] = 0;
+                continue;
+            }
+            mValue[i] = lRead[2] ? (uint64_t) ((double) lRead[0] * (double) lRead[1] / (double) lRead[2]) : 0;
+        }
+#endif
+    }
+
+    bool available(Counter aCounter) const {
+        return mFd[aCounter] >= 0;
+    }
+
+    //The count between start() and stop()
+    uint64_t value(Counter aCounter) const {
+        return mValue[aCounter];
+    }
+
+    void close() {
+#ifdef __linux
+        for (auto &rFd: mFd) {
+            if (rFd >= 0) {
+                ::close(rFd);
+                rFd = -1;
+            }
+        }
+#endif
+    }
+
+    ///Delete copy and move constructors and assign operators
+    PerfCounters(PerfCounters const &) = delete;              // Copy construct
+    PerfCounters(PerfCounters &&) = delete;                   // Move construct
+    PerfCounters &operator=(PerfCounters const &) = delete;   // Copy assign
+    PerfCounters &operator=(PerfCounters &&) = delete;        // Move assign
+private:
+    uint64_t mHitmEvent;
+    int mFd[COUNTERS];
+    uint64_t mValue[COUNTERS] = {};
+};
@@ -103,3 +103,193 @@ bool pinThread(int32_t aCpu) {
 #error OS not supported
 #endif
 
+
+// Topology helpers
+// Pick a consumer and producer CPU pair by what they share instead of hardcoding CPU numbers
+// int32_t consumer, producer;
+// if (pickCpuPair(CpuSharing::L3, consumer, producer)) { pin the consumer to consumer and the producer to producer }
+// cpuNumaNode(cpu) is the NUMA node of a CPU (for FastQueueNuma)
+// The topology is read from Linux sysfs (/sys/devices/system/cpu/cpu*/topology, cache/index*/shared_cpu_list
+// and /sys/devices/system/node). On other systems cpuTopology() is empty and pickCpuPair() returns false.
+
+#include <cstdint>
+#include <string>
+#include <vector>
+#include <fstream>
+#include <algorithm>
+
+enum class CpuSharing {
+    SMT,        //Two hardware threads of one core
+    L2,         //Two cores sharing the L2 cache (SMT siblings if no two cores share L2, the L2 is often per core)
+    L3,         //Two cores sharing the L3 cache
+    NUMA_NODE,  //Two cores on the same NUMA node (the same package if there is no NUMA information)
+    CROSS_NODE  //Two cores on different NUMA nodes (different packages if there is no NUMA information)
+};
+
+struct CpuInfo {
+    int32_t mCpu = -1;
+    int32_t mCore = -1;     //core_id, unique within the package
+    int32_t mPackage = -1;
+    int32_t mNode = -1;     //NUMA node, -1 if not known
+    std::vector<int32_t> mSharedL2; //CPUs sharing the L2 including this one
+    std::vector<int32_t> mSharedL3; //CPUs sharing the L3 including this one
+};
+
+//Parses a sysfs CPU list like "0-3,8,10-11"
+inline std::vector<int32_t> parseCpuList(const std::string &rList) {
+    std::vector<int32_t> lCpus;
+    size_t lStart = 0;
+    while (lStart < rList.size()) {
+        size_t lEnd = rList.find(',', lStart);
+        if (lEnd == std::string::npos) {
+            lEnd = rList.size();
+        }
+        std::string lRange = rList.substr(lStart, lEnd - lStart);
+        size_t lDash = lRange.find('-');
+        try {
+            int32_t lFirst = std::stoi(lRange.substr(0, lDash));
+            int32_t lLast = lDash == std::string::npos ? lFirst : std::stoi(lRange.substr(lDash + 1));
+            for (int32_t i = lFirst; i <= lLast; i++) {
+                lCpus.push_back(i);
+            }
+        } catch (const std::exception &) {
+            //Not a number (trailing new line or an empty list)
+        }
+        lStart = lEnd + 1;
+    }
+    return lCpus;
+}
+
+#ifdef __linux
+//First line of a sysfs file, empty if it does not exist
+inline std::string readSysfs(const std::string &rPath) {
+    std::ifstream lFile(rPath);
+    std::string lLine;
+    std::getline(lFile, lLine);
+    return lLine;
+}
+
+inline int32_t readSysfsNumber(const std::string &rPath) {
+    try {
+        return std::stoi(readSysfs(rPath));
+    } catch (const std::exception &) {
+        return -1;
+    }
+}
+
+//aRoot is the sysfs system directory
+inline std::vector<CpuInfo> cpuTopology(const std::string &rRoot = "/sys/devices/system") {
+    std::vector<CpuInfo> lTopology;
+    for (auto lCpu: parseCpuList(readSysfs(rRoot + "/cpu/online"))) {
+        CpuInfo lInfo;
+        std::string lPath = rRoot + "/cpu/cpu" + std::to_string(lCpu);
+        lInfo.mCpu = lCpu;
+        lInfo.mCore = readSysfsNumber(lPath + "/topology/core_id");
+        lInfo.mPackage = readSysfsNumber(lPath + "/topology/physical_package_id");
+        for (int32_t lIndex = 0;; lIndex++) {
+            std::string lCache = lPath + "/cache/index" + std::to_string(lIndex);
+            int32_t lLevel = readSysfsNumber(lCache + "/level");
+            if (lLevel < 0) {
+                break;
+            }
+            if (readSysfs(lCache + "/type") == "Instruction") {
+                continue;
+            }
+            if (lLevel == 2) {
+                lInfo.mSharedL2 = parseCpuList(readSysfs(lCache + "/shared_cpu_list"));
+            } else if (lLevel == 3) {
+                lInfo.mSharedL3 = parseCpuList(readSysfs(lCache + "/shared_cpu_list"));
+            }
+        }
+        lTopology.push_back(lInfo);
+    }
+    for (auto lNode: parseCpuList(readSysfs(rRoot + "/node/possible"))) {
+        for (auto lCpu: parseCpuList(readSysfs(rRoot + "/node/node" + std::to_string(lNode) + "/cpulist"))) {
+            for (auto &rInfo: lTopology) {
+                if (rInfo.mCpu == lCpu) {
+                    rInfo.mNode = lNode;
+                }
+            }
+        }
+    }
+    return lTopology;
+}
+#else
+inline std::vector<CpuInfo> cpuTopology() {
+    return {};
+}
+#endif
+
+//True if the two CPUs share aSharing
+inline bool cpusShare(const CpuInfo &rA, const CpuInfo &rB, CpuSharing aSharing) {
+    bool lSameCore = rA.mPackage == rB.mPackage && rA.mCore == rB.mCore;
+    auto lIn = [](const std::vector<int32_t> &rCpus, int32_t aCpu) {
+        return std::find(rCpus.begin(), rCpus.end(), aCpu) != rCpus.end();
+    };
+    switch (aSharing) {
+        case CpuSharing::SMT:
+            return lSameCore;
+        case CpuSharing::L2:
+            return !lSameCore && lIn(rA.mSharedL2, rB.mCpu);
+        case CpuSharing::L3:
+            return !lSameCore && lIn(rA.mSharedL3, rB.mCpu);
+        case CpuSharing::NUMA_NODE:
+            if (rA.mNode >= 0 && rB.mNode >= 0) {
+                return !lSameCore && rA.mNode == rB.mNode;
+            }
+            return !lSameCore && rA.mPackage == rB.mPackage;
+        case CpuSharing::CROSS_NODE:
+            if (rA.mNode >= 0 && rB.mNode >= 0) {
+                return rA.mNode != rB.mNode;
+            }
+            return rA.mPackage != rB.mPackage;
+    }
+    return false;
+}
+
+//Picks a consumer and a producer CPU sharing aSharing from rTopology. The core of CPU 0 is only used if there is
+//no other pair, CPU 0 takes most of the interrupts. Returns false if there is no such pair.
+inline bool pickCpuPair(const std::vector<CpuInfo> &rTopology, CpuSharing aSharing, int32_t &rConsumer,
+                        int32_t &rProducer) {
+    auto lOnCoreZero = [&rTopology](const CpuInfo &rInfo) {
+        for (auto &rZero: rTopology) {
+            if (rZero.mCpu == 0) {
+                return rInfo.mCpu == 0 || cpusShare(rInfo, rZero, CpuSharing::SMT);
+            }
+        }
+        return false;
+    };
+    for (int lPass = 0; lPass < 2; lPass++) {
+        for (size_t i = 0; i < rTopology.size(); i++) {
+            for (size_t j = i + 1; j < rTopology.size(); j++) {
+                if (!lPass && (lOnCoreZero(rTopology[i]) || lOnCoreZero(rTopology[j]))) {
+                    continue;
+                }
+                if (cpusShare(rTopology[i], rTopology[j], aSharing)) {
+                    rConsumer = rTopology[i].mCpu;
+                    rProducer = rTopology[j].mCpu;
+                    return true;
+                }
+            }
+        }
+    }
+    //A private L2 is shared by the SMT siblings only
+    if (aSharing == CpuSharing::L2) {
+        return pickCpuPair(rTopology, CpuSharing::SMT, rConsumer, rProducer);
+    }
+    return false;
+}
+
+inline bool pickCpuPair(CpuSharing aSharing, int32_t &rConsumer, int32_t &rProducer) {
+    return pickCpuPair(cpuTopology(), aSharing, rConsumer, rProducer);
+}
+
+//NUMA node of aCpu, -1 if not known
+inline int32_t cpuNumaNode(int32_t aCpu) {
+    for (auto &rInfo: cpuTopology()) {
+        if (rInfo.mCpu == aCpu) {
+            return rInfo.mNode;
+        }
+    }
+    return -1;
+}
@@ -4,10 +4,19 @@
 .align 6
 .global _push_item
 .global _pop_item
-.global _verify_mask
 .global _verify_cache_size
+.global _try_push_item
+.global _try_pop_item
+.global _push_items
+.global _pop_items
+.global _push_item_lrcpc
+.global _pop_item_lrcpc
+.global _push_item_acqrel
+.global _pop_item_acqrel
+
+;ldapr (FEAT_LRCPC, Armv8.3) is only executed if FastQueueASM::hasLrcpc() says the CPU has it
+.arch_extension rcpc
 
-.equ BUFFER_MASK, 15
 .equ L1_CACHE, 64
 .equ SHIFT_NO, ((L1_CACHE) / ((L1_CACHE) % 255 + 1) / 255 % 255 * 8 + 7 - 86 / ((L1_CACHE) % 255 + 12))
 
@@ -27,10 +36,11 @@ pop_loop:
     eor x0, x0, x0
     ret
 entry_found:
+    ldr x4, [x3, #L1_CACHE * 7] ;mMask
     add x2, x1, #1
-    and x1, x1, BUFFER_MASK
+    and x1, x1, x4
     lsl x1, x1, SHIFT_NO
-    add x1, x1, #L1_CACHE * 7 ;mRingBuffer
+    add x1, x1, #L1_CACHE * 8 ;mRingBuffer
     ldr x0, [x3, x1]
     dmb ishld
     str x2, [x3, #L1_CACHE * 4] ;mReadPositionPop
@@ -39,19 +49,20 @@ entry_found:
 
 _push_item:
     ldr x2, [x0, #L1_CACHE * 1] ;mWritePositionPush
+    ldr x5, [x0, #L1_CACHE * 7] ;mMask
 push_loop:
     ldr x3, [x0, #L1_CACHE * 6] ;mExitThreadSemaphore (1 = true)
     cmp x3, #0
     bne exit_loop
     ldr x4, [x0, #L1_CACHE * 2] ;mReadPositionPush
     sub x3, x2, x4
-    cmp x3, BUFFER_MASK
+    cmp x3, x5
     bge push_loop
     mov x3, x2
     add x2, x2, #1
-    and x3, x3, BUFFER_MASK
+    and x3, x3, x5
     lsl x3, x3, SHIFT_NO
-    add x3, x3, #L1_CACHE * 7 ;mRingBuffer
+    add x3, x3, #L1_CACHE * 8 ;mRingBuffer
     str x1,[x0, x3]
     dmb ishst
     str x2,[x0, #L1_CACHE * 1] ;mWritePositionPush
@@ -59,10 +70,189 @@ push_loop:
 exit_loop:
     ret
 
-_verify_mask:
-    sub x0, x0, BUFFER_MASK
-    ret
-
 _verify_cache_size:
     sub x0, x0, L1_CACHE
-    ret
\ No newline at end of file
+    ret
+
+;returns 1 if pushed, 0 if the queue is full or stopped
+_try_push_item:
+    mov x3, x0
+    mov x0, #0
+    ldr x4, [x3, #L1_CACHE * 6] ;mExitThreadSemaphore (1 = true)
+    cbnz x4, try_push_exit
+    ldr x2, [x3, #L1_CACHE * 1] ;mWritePositionPush
+    ldr x5, [x3, #L1_CACHE * 7] ;mMask
+    ldr x4, [x3, #L1_CACHE * 2] ;mReadPositionPush
+    sub x4, x2, x4
+    cmp x4, x5
+    bge try_push_exit
+    and x4, x2, x5
+    add x2, x2, #1
+    lsl x4, x4, SHIFT_NO
+    add x4, x4, #L1_CACHE * 8 ;mRingBuffer
+    str x1, [x3, x4]
+    dmb ishst
+    str x2, [x3, #L1_CACHE * 1] ;mWritePositionPush
+    str x2, [x3, #L1_CACHE * 3] ;mWritePositionPop
+    mov x0, #1
+try_push_exit:
+    ret
+
+;x1 = where to store the pointer, returns 1 if popped, 0 if the queue is empty, 2 if the queue is stopped and empty
+_try_pop_item:
+    mov x3, x0
+    ldr x2, [x3, #L1_CACHE * 4] ;mReadPositionPop
+    ldr x4, [x3, #L1_CACHE * 3] ;mWritePositionPop
+    cmp x2, x4
+    bne try_pop_found
+    mov x0, #0
+    ldr x4, [x3, #L1_CACHE * 5] ;mExitThread
+    cmp x4, x2
+    bne try_pop_exit
+    ldr x5, [x3, #L1_CACHE * 6] ;mExitThreadSemaphore (1 = true)
+    cbz x5, try_pop_exit
+    mov x0, #2
+try_pop_exit:
+    ret
+try_pop_found:
+    ldr x5, [x3, #L1_CACHE * 7] ;mMask
+    and x4, x2, x5
+    add x2, x2, #1
+    lsl x4, x4, SHIFT_NO
+    add x4, x4, #L1_CACHE * 8 ;mRingBuffer
+    ldr x0, [x3, x4]
+    dmb ishld
+    str x0, [x1]
+    str x2, [x3, #L1_CACHE * 4] ;mReadPositionPop
+    str x2, [x3, #L1_CACHE * 2] ;mReadPositionPush
+    mov x0, #1
+    ret
+
+;x1 = the pointers, x2 = count. Pushes what fits, one barrier and index publish for the batch.
+;returns the number pushed, 0 if the queue is full or stopped
+_push_items:
+    mov x3, x0
+    mov x0, #0
+    cbz x2, push_items_exit
+    ldr x4, [x3, #L1_CACHE * 6] ;mExitThreadSemaphore (1 = true)
+    cbnz x4, push_items_exit
+    ldr x4, [x3, #L1_CACHE * 1] ;mWritePositionPush
+    ldr x5, [x3, #L1_CACHE * 7] ;mMask
+    ldr x6, [x3, #L1_CACHE * 2] ;mReadPositionPush
+    sub x6, x4, x6
+    subs x6, x5, x6 ;free entries
+    ble push_items_exit
+    cmp x2, x6
+    csel x6, x2, x6, lo
+push_items_loop:
+    and x7, x4, x5
+    lsl x7, x7, SHIFT_NO
+    add x7, x7, #L1_CACHE * 8 ;mRingBuffer
+    ldr x8, [x1, x0, lsl #3]
+    str x8, [x3, x7]
+    add x4, x4, #1
+    add x0, x0, #1
+    cmp x0, x6
+    bne push_items_loop
+    dmb ishst
+    str x4, [x3, #L1_CACHE * 1] ;mWritePositionPush
+    str x4, [x3, #L1_CACHE * 3] ;mWritePositionPop
+push_items_exit:
+    ret
+
+;x1 = where to store the pointers, x2 = max count. One barrier and index publish for the batch.
+;returns the number popped, 0 if the queue is empty (_try_pop_item tells if it is also stopped)
+_pop_items:
+    mov x3, x0
+    mov x0, #0
+    cbz x2, pop_items_exit
+    ldr x4, [x3, #L1_CACHE * 4] ;mReadPositionPop
+    ldr x6, [x3, #L1_CACHE * 3] ;mWritePositionPop
+    subs x6, x6, x4 ;entries ready
+    beq pop_items_exit
+    cmp x2, x6
+    csel x6, x2, x6, lo
+    ldr x5, [x3, #L1_CACHE * 7] ;mMask
+pop_items_loop:
+    and x7, x4, x5
+    lsl x7, x7, SHIFT_NO
+    add x7, x7, #L1_CACHE * 8 ;mRingBuffer
+    ldr x8, [x3, x7]
+    str x8, [x1, x0, lsl #3]
+    add x4, x4, #1
+    add x0, x0, #1
+    cmp x0, x6
+    bne pop_items_loop
+    dmb ishld
+    str x4, [x3, #L1_CACHE * 4] ;mReadPositionPop
+    str x4, [x3, #L1_CACHE * 2] ;mReadPositionPush
+pop_items_exit:
+    ret
+
+;Acquire/release versions of _push_item and _pop_item. No dmb, the index the other side reads is published
+;with stlr and read with a load-acquire. ACQUIRE is ldapr (RCpc) or ldar (RCsc) for CPUs without RCpc.
+;ldapr does not have to wait for the stlr of the previous item, ldar does.
+;When the queue is empty the consumer parks in wfe with the exclusive monitor armed on mWritePositionPop,
+;the producer publishing the next item wakes it. stopQueue() sends a sev.
+.macro PUSH_ITEM_ACQREL NAME, ACQUIRE
+\NAME:
+    ldr x2, [x0, #L1_CACHE * 1] ;mWritePositionPush
+    ldr x5, [x0, #L1_CACHE * 7] ;mMask
+    add x6, x0, #L1_CACHE * 2 ;mReadPositionPush
+    add x7, x0, #L1_CACHE * 3 ;mWritePositionPop
+1:
+    ldr x3, [x0, #L1_CACHE * 6] ;mExitThreadSemaphore (1 = true)
+    cbnz x3, 2f
+    \ACQUIRE x4, [x6]
+    sub x3, x2, x4
+    cmp x3, x5
+    bge 1b
+    and x3, x2, x5
+    add x2, x2, #1
+    lsl x3, x3, SHIFT_NO
+    add x3, x3, #L1_CACHE * 8 ;mRingBuffer
+    str x1, [x0, x3]
+    str x2, [x0, #L1_CACHE * 1] ;mWritePositionPush
+    stlr x2, [x7] ;the release orders the item before the index
+2:
+    ret
+.endm
+
+.macro POP_ITEM_ACQREL NAME, ACQUIRE
+\NAME:
+    mov x3, x0
+    ldr x1, [x3, #L1_CACHE * 4] ;mReadPositionPop
+    add x6, x3, #L1_CACHE * 3 ;mWritePositionPop
+    \ACQUIRE x2, [x6]
+    cmp x1, x2
+    bne 2f
+    sevl
+1:
+    wfe
+    ldaxr x2, [x6] ;arms the monitor, the producer storing the index wakes the next wfe
+    cmp x1, x2
+    bne 2f
+    ldr x4, [x3, #L1_CACHE * 5] ;mExitThread
+    cmp x4, x1
+    bne 1b
+    ldr x5, [x3, #L1_CACHE * 6] ;mExitThreadSemaphore (1 = true)
+    cbz x5, 1b
+    mov x0, #0
+    ret
+2:
+    ldr x4, [x3, #L1_CACHE * 7] ;mMask
+    add x2, x1, #1
+    and x1, x1, x4
+    lsl x1, x1, SHIFT_NO
+    add x1, x1, #L1_CACHE * 8 ;mRingBuffer
+    ldr x0, [x3, x1]
+    str x2, [x3, #L1_CACHE * 4] ;mReadPositionPop
+    add x6, x3, #L1_CACHE * 2 ;mReadPositionPush
+    stlr x2, [x6] ;the release orders the item load before the index
+    ret
+.endm
+
+PUSH_ITEM_ACQREL _push_item_lrcpc, ldapr
+POP_ITEM_ACQREL _pop_item_lrcpc, ldapr
+PUSH_ITEM_ACQREL _push_item_acqrel, ldar
+POP_ITEM_ACQREL _pop_item_acqrel, ldar
@@ -3,20 +3,20 @@
 section .text
 bits 64
 
-BUFFER_MASK         equ 15
 L1_CACHE            equ 64
 SHIFT_NO            equ ((L1_CACHE) / ((L1_CACHE) % 255 + 1) / 255 % 255 * 8 + 7 - 86 / ((L1_CACHE) % 255 + 12))
+UMWAIT_CYCLES       equ 100000 ;TSC cycles a pop_item_umwait wait lasts at most
 
 global push_item
 global pop_item
-global verify_mask
+global try_push_item
+global try_pop_item
+global push_items
+global pop_items
+global pop_item_umwait
+global pop_item_pause
 global verify_cache_size
 
-verify_mask:
-    mov rax,rdi
-    sub rax, BUFFER_MASK
-    ret
-
 verify_cache_size:
     mov rax,rdi
     sub rax, L1_CACHE
@@ -24,18 +24,19 @@ verify_cache_size:
 
 push_item:
     mov r11, [rdi + (L1_CACHE * 1)] ;mWritePositionPush
+    mov r10, [rdi + (L1_CACHE * 7)] ;mMask
 push_loop:
     cmp [rdi + (L1_CACHE * 6)], byte 0 ;mExitThreadSemaphore
     jnz exit_loop
     mov rcx, r11
     sub rcx, [rdi + (L1_CACHE * 2)] ;mReadPositionPush
-    cmp rcx, BUFFER_MASK
+    cmp rcx, r10
     jge push_loop
     mov rax, r11
     inc r11
-    and rax, BUFFER_MASK
+    and rax, r10
     shl rax, SHIFT_NO
-    add rax, (L1_CACHE * 7) ;mRingBuffer
+    add rax, (L1_CACHE * 8) ;mRingBuffer
     mov [rdi + rax], rsi
     sfence
     mov [rdi + (L1_CACHE * 1)], r11 ;mWritePositionPush
@@ -56,12 +57,167 @@ pop_item:
 entry_found:
     mov r11, rcx
     inc r11
-    and rcx, BUFFER_MASK
+    and rcx, [rdi + (L1_CACHE * 7)] ;mMask
     shl rcx, SHIFT_NO
-    add rcx, (L1_CACHE * 7) ;mRingBuffer
+    add rcx, (L1_CACHE * 8) ;mRingBuffer
     mov rax, [rdi + rcx]
     lfence
     mov [rdi + (L1_CACHE * 4)], r11 ;mReadPositionPop
     mov [rdi + (L1_CACHE * 2)], r11 ;mReadPositionPush
 	ret
 
+;returns 1 if pushed, 0 if the queue is full or stopped
+try_push_item:
+    xor rax, rax
+    cmp [rdi + (L1_CACHE * 6)], byte 0 ;mExitThreadSemaphore
+    jnz try_push_exit
+    mov r11, [rdi + (L1_CACHE * 1)] ;mWritePositionPush
+    mov r10, [rdi + (L1_CACHE * 7)] ;mMask
+    mov rcx, r11
+    sub rcx, [rdi + (L1_CACHE * 2)] ;mReadPositionPush
+    cmp rcx, r10
+    jge try_push_exit
+    mov rcx, r11
+    inc r11
+    and rcx, r10
+    shl rcx, SHIFT_NO
+    add rcx, (L1_CACHE * 8) ;mRingBuffer
+    mov [rdi + rcx], rsi
+    sfence
+    mov [rdi + (L1_CACHE * 1)], r11 ;mWritePositionPush
+    mov [rdi + (L1_CACHE * 3)], r11 ;mWritePositionPop
+    inc rax
+try_push_exit:
+    ret
+
+;rsi = where to store the pointer, returns 1 if popped, 0 if the queue is empty, 2 if the queue is stopped and empty
+try_pop_item:
+    mov rcx, [rdi + (L1_CACHE * 4)] ;mReadPositionPop
+    cmp rcx, [rdi + (L1_CACHE * 3)] ;mWritePositionPop
+    jne try_pop_found
+    xor rax, rax
+    cmp rcx, [rdi + (L1_CACHE * 5)] ;mExitThread
+    jne try_pop_exit
+    cmp [rdi + (L1_CACHE * 6)], byte 0 ;mExitThreadSemaphore (1 = true)
+    jz try_pop_exit
+    mov rax, 2
+try_pop_exit:
+    ret
+try_pop_found:
+    mov r11, rcx
+    inc r11
+    and rcx, [rdi + (L1_CACHE * 7)] ;mMask
+    shl rcx, SHIFT_NO
+    add rcx, (L1_CACHE * 8) ;mRingBuffer
+    mov rax, [rdi + rcx]
+    lfence
+    mov [rsi], rax
+    mov [rdi + (L1_CACHE * 4)], r11 ;mReadPositionPop
+    mov [rdi + (L1_CACHE * 2)], r11 ;mReadPositionPush
+    mov rax, 1
+    ret
+
+;rsi = the pointers, rdx = count. Pushes what fits, one fence and index publish for the batch.
+;returns the number pushed, 0 if the queue is full or stopped
+push_items:
+    xor rax, rax
+    test rdx, rdx
+    jz push_items_exit
+    cmp [rdi + (L1_CACHE * 6)], byte 0 ;mExitThreadSemaphore
+    jnz push_items_exit
+    mov r11, [rdi + (L1_CACHE * 1)] ;mWritePositionPush
+    mov r10, [rdi + (L1_CACHE * 7)] ;mMask
+    mov rcx, r11
+    sub rcx, [rdi + (L1_CACHE * 2)] ;mReadPositionPush
+    mov r9, r10
+    sub r9, rcx ;free entries
+    jle push_items_exit
+    cmp rdx, r9
+    cmovb r9, rdx
+push_items_loop:
+    mov rcx, r11
+    and rcx, r10
+    shl rcx, SHIFT_NO
+    add rcx, (L1_CACHE * 8) ;mRingBuffer
+    mov r8, [rsi + rax * 8]
+    mov [rdi + rcx], r8
+    inc r11
+    inc rax
+    cmp rax, r9
+    jne push_items_loop
+    sfence
+    mov [rdi + (L1_CACHE * 1)], r11 ;mWritePositionPush
+    mov [rdi + (L1_CACHE * 3)], r11 ;mWritePositionPop
+push_items_exit:
+    ret
+
+;rsi = where to store the pointers, rdx = max count. One fence and index publish for the batch.
+;returns the number popped, 0 if the queue is empty (try_pop_item tells if it is also stopped)
+pop_items:
+    xor rax, rax
+    test rdx, rdx
+    jz pop_items_exit
+    mov r11, [rdi + (L1_CACHE * 4)] ;mReadPositionPop
+    mov r9, [rdi + (L1_CACHE * 3)] ;mWritePositionPop
+    sub r9, r11 ;entries ready
+    jz pop_items_exit
+    cmp rdx, r9
+    cmovb r9, rdx
+    mov r10, [rdi + (L1_CACHE * 7)] ;mMask
+pop_items_loop:
+    mov rcx, r11
+    and rcx, r10
+    shl rcx, SHIFT_NO
+    add rcx, (L1_CACHE * 8) ;mRingBuffer
+    mov r8, [rdi + rcx]
+    mov [rsi + rax * 8], r8
+    inc r11
+    inc rax
+    cmp rax, r9
+    jne pop_items_loop
+    lfence
+    mov [rdi + (L1_CACHE * 4)], r11 ;mReadPositionPop
+    mov [rdi + (L1_CACHE * 2)], r11 ;mReadPositionPush
+pop_items_exit:
+    ret
+
+;pop_item that waits in UMWAIT (C0.1) with UMONITOR armed on mWritePositionPop while the queue is empty.
+;Only call it if CPUID reports WAITPKG. The stop is seen when the wait times out.
+pop_item_umwait:
+    mov rcx, [rdi + (L1_CACHE * 4)] ;mReadPositionPop
+pop_umwait_loop:
+    cmp rcx, [rdi + (L1_CACHE * 3)] ;mWritePositionPop
+    jne entry_found
+    cmp rcx, [rdi + (L1_CACHE * 5)] ;mExitThread
+    jne pop_umwait_wait
+    cmp [rdi + (L1_CACHE * 6)], byte 0 ;mExitThreadSemaphore (1 = true)
+    jz pop_umwait_wait
+    xor rax, rax
+    ret
+pop_umwait_wait:
+    lea rax, [rdi + (L1_CACHE * 3)]
+    umonitor rax
+    cmp rcx, [rdi + (L1_CACHE * 3)] ;written before the monitor was armed
+    jne entry_found
+    rdtsc
+    add eax, UMWAIT_CYCLES
+    adc edx, 0 ;deadline in edx:eax
+    mov r8d, 1 ;C0.1
+    umwait r8d
+    jmp pop_umwait_loop
+
+;pop_item with a pause in the empty loop, for CPUs without WAITPKG
+pop_item_pause:
+    mov rcx, [rdi + (L1_CACHE * 4)] ;mReadPositionPop
+pop_pause_loop:
+    cmp rcx, [rdi + (L1_CACHE * 3)] ;mWritePositionPop
+    jne entry_found
+    cmp rcx, [rdi + (L1_CACHE * 5)] ;mExitThread
+    jne pop_pause_wait
+    cmp [rdi + (L1_CACHE * 6)], byte 0 ;mExitThreadSemaphore (1 = true)
+    jz pop_pause_wait
+    xor rax, rax
+    ret
+pop_pause_wait:
+    pause
+    jmp pop_pause_loop